@@ -0,0 +1,488 @@
+#ifndef SM4_H
+#define SM4_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+// GB/T 32907 SM4 룬ԿΪ128λ32ַƽFeistelṹ
+constexpr int SM4_BLOCK_SIZE = 16;
+constexpr int SM4_ROUNDS = 32;
+
+const uint8_t SBox[256] = {
+    0xD6, 0x90, 0xE9, 0xFE, 0xCC, 0xE1, 0x3D, 0xB7,
+    0x16, 0xB6, 0x14, 0xC2, 0x28, 0xFB, 0x2C, 0x05,
+    0x2B, 0x67, 0x9A, 0x76, 0x2A, 0xBE, 0x04, 0xC3,
+    0xAA, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+    0x9C, 0x42, 0x50, 0xF4, 0x91, 0xEF, 0x98, 0x7A,
+    0x33, 0x54, 0x0B, 0x43, 0xED, 0xCF, 0xAC, 0x62,
+    0xE4, 0xB3, 0x1C, 0xA9, 0xC9, 0x08, 0xE8, 0x95,
+    0x80, 0xDF, 0x94, 0xFA, 0x75, 0x8F, 0x3F, 0xA6,
+    0x47, 0x07, 0xA7, 0xFC, 0xF3, 0x73, 0x17, 0xBA,
+    0x83, 0x59, 0x3C, 0x19, 0xE6, 0x85, 0x4F, 0xA8,
+    0x68, 0x6B, 0x81, 0xB2, 0x71, 0x64, 0xDA, 0x8B,
+    0xF8, 0xEB, 0x0F, 0x4B, 0x70, 0x56, 0x9D, 0x35,
+    0x1E, 0x24, 0x0E, 0x5E, 0x63, 0x58, 0xD1, 0xA2,
+    0x25, 0x22, 0x7C, 0x3B, 0x01, 0x21, 0x78, 0x87,
+    0xD4, 0x00, 0x46, 0x57, 0x9F, 0xD3, 0x27, 0x52,
+    0x4C, 0x36, 0x02, 0xE7, 0xA0, 0xC4, 0xC8, 0x9E,
+    0xEA, 0xBF, 0x8A, 0xD2, 0x40, 0xC7, 0x38, 0xB5,
+    0xA3, 0xF7, 0xF2, 0xCE, 0xF9, 0x61, 0x15, 0xA1,
+    0xE0, 0xAE, 0x5D, 0xA4, 0x9B, 0x34, 0x1A, 0x55,
+    0xAD, 0x93, 0x32, 0x30, 0xF5, 0x8C, 0xB1, 0xE3,
+    0x1D, 0xF6, 0xE2, 0x2E, 0x82, 0x66, 0xCA, 0x60,
+    0xC0, 0x29, 0x23, 0xAB, 0x0D, 0x53, 0x4E, 0x6F,
+    0xD5, 0xDB, 0x37, 0x45, 0xDE, 0xFD, 0x8E, 0x2F,
+    0x03, 0xFF, 0x6A, 0x72, 0x6D, 0x6C, 0x5B, 0x51,
+    0x8D, 0x1B, 0xAF, 0x92, 0xBB, 0xDD, 0xBC, 0x7F,
+    0x11, 0xD9, 0x5C, 0x41, 0x1F, 0x10, 0x5A, 0xD8,
+    0x0A, 0xC1, 0x31, 0x88, 0xA5, 0xCD, 0x7B, 0xBD,
+    0x2D, 0x74, 0xD0, 0x12, 0xB8, 0xE5, 0xB4, 0xB0,
+    0x89, 0x69, 0x97, 0x4A, 0x0C, 0x96, 0x77, 0x7E,
+    0x65, 0xB9, 0xF1, 0x09, 0xC5, 0x6E, 0xC6, 0x84,
+    0x18, 0xF0, 0x7D, 0xEC, 0x3A, 0xDC, 0x4D, 0x20,
+    0x79, 0xEE, 0x5F, 0x3E, 0xD7, 0xCB, 0x39, 0x48
+};
+
+const uint32_t Fk[4] = {
+    0xA3B1BAC6,
+    0x56AA3350,
+    0x677D9197,
+    0xB27022DC
+};
+
+// ̶ CK i ֵĵ j ֽΪ (4i + j)  7 mod 256
+const uint32_t Ck[32] = {
+    0x00070E15, 0x1C232A31, 0x383F464D, 0x545B6269,
+    0x70777E85, 0x8C939AA1, 0xA8AFB6BD, 0xC4CBD2D9,
+    0xE0E7EEF5, 0xFC030A11, 0x181F262D, 0x343B4249,
+    0x50575E65, 0x6C737A81, 0x888F969D, 0xA4ABB2B9,
+    0xC0C7CED5, 0xDCE3EAF1, 0xF8FF060D, 0x141B2229,
+    0x30373E45, 0x4C535A61, 0x686F767D, 0x848B9299,
+    0xA0A7AEB5, 0xBCC3CAD1, 0xD8DFE6ED, 0xF4FB0209,
+    0x10171E25, 0x2C333A41, 0x484F565D, 0x646B7279
+};
+
+inline uint32_t sm4_left_rotate(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline uint32_t load_word(const uint8_t bytes[4]) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) |
+        (static_cast<uint32_t>(bytes[1]) << 16) |
+        (static_cast<uint32_t>(bytes[2]) << 8) |
+        static_cast<uint32_t>(bytes[3]);
+}
+
+inline void store_word(uint32_t word, uint8_t bytes[4]) {
+    bytes[0] = (word >> 24) & 0xFF;
+    bytes[1] = (word >> 16) & 0xFF;
+    bytes[2] = (word >> 8) & 0xFF;
+    bytes[3] = word & 0xFF;
+}
+
+// Ա任 ӣÿֽڲS
+inline uint32_t nonlinear_transform(uint32_t word) {
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+        result |= static_cast<uint32_t>(SBox[(word >> (8 * (3 - i))) & 0xFF]) << (8 * (3 - i));
+    }
+    return result;
+}
+
+// ֺеԱ任 L
+inline uint32_t linear_transform(uint32_t word) {
+    return word ^ sm4_left_rotate(word, 2) ^ sm4_left_rotate(word, 10) ^ sm4_left_rotate(word, 18) ^ sm4_left_rotate(word, 24);
+}
+
+// ԿչеԱ任 L'
+inline uint32_t key_linear_transform(uint32_t word) {
+    return word ^ sm4_left_rotate(word, 13) ^ sm4_left_rotate(word, 23);
+}
+
+inline uint32_t round_function(uint32_t input, uint32_t round_key) {
+    return linear_transform(nonlinear_transform(input ^ round_key));
+}
+
+// ԿչK_i = MK_i  FK_irk_i = K_{i+4} = K_i  T'(K_{i+1}  K_{i+2}  K_{i+3}  CK_i)
+inline vector<uint32_t> key_expansion(const uint8_t key[16]) {
+    vector<uint32_t> round_keys(SM4_ROUNDS);
+    uint32_t k[4];
+    for (int i = 0; i < 4; ++i) {
+        k[i] = load_word(key + 4 * i) ^ Fk[i];
+    }
+    for (int i = 0; i < SM4_ROUNDS; ++i) {
+        uint32_t next = k[0] ^ key_linear_transform(nonlinear_transform(k[1] ^ k[2] ^ k[3] ^ Ck[i]));
+        round_keys[i] = next;
+        k[0] = k[1];
+        k[1] = k[2];
+        k[2] = k[3];
+        k[3] = next;
+    }
+    return round_keys;
+}
+
+// չԿһ顣ܰ rk_0..rk_31 ˳򣬽ܰ෴˳ʹͬһԿ
+inline void sm4_crypt_block(const uint8_t input[16], const uint32_t round_keys[SM4_ROUNDS], bool decrypt, uint8_t output[16]) {
+    uint32_t x[4];
+    for (int i = 0; i < 4; ++i) {
+        x[i] = load_word(input + 4 * i);
+    }
+    for (int r = 0; r < SM4_ROUNDS; ++r) {
+        uint32_t next = x[0] ^ round_function(x[1] ^ x[2] ^ x[3], round_keys[decrypt ? SM4_ROUNDS - 1 - r : r]);
+        x[0] = x[1];
+        x[1] = x[2];
+        x[2] = x[3];
+        x[3] = next;
+    }
+    // 任 R (X35, X34, X33, X32)
+    for (int i = 0; i < 4; ++i) {
+        store_word(x[3 - i], output + 4 * i);
+    }
+}
+
+inline void sm4_encrypt(const uint8_t plaintext[16], const uint8_t key[16], uint8_t ciphertext[16]) {
+    vector<uint32_t> round_keys = key_expansion(key);
+    sm4_crypt_block(plaintext, round_keys.data(), false, ciphertext);
+}
+
+inline void sm4_decrypt(const uint8_t ciphertext[16], const uint8_t key[16], uint8_t plaintext[16]) {
+    vector<uint32_t> round_keys = key_expansion(key);
+    sm4_crypt_block(ciphertext, round_keys.data(), true, plaintext);
+}
+
+// ֽھ volatile ָ㣬Ѽͷŵڴϵ memset Ż
+inline void sm4_secure_wipe(void* data, size_t length) {
+    volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        p[i] = 0;
+    }
+}
+
+// ܺͽܸһԿܵһѾ߶ sm4_crypt_block(..., false, ...) ˳ʹ
+struct sm4_key_schedule {
+    uint32_t encrypt[SM4_ROUNDS];
+    uint32_t decrypt[SM4_ROUNDS];
+};
+
+inline void sm4_expand_schedule(const uint8_t key[16], sm4_key_schedule& schedule) {
+    vector<uint32_t> round_keys = key_expansion(key);
+    for (int i = 0; i < SM4_ROUNDS; ++i) {
+        schedule.encrypt[i] = round_keys[i];
+        schedule.decrypt[i] = round_keys[SM4_ROUNDS - 1 - i];
+    }
+    sm4_secure_wipe(round_keys.data(), round_keys.size() * sizeof(uint32_t));
+}
+
+// ԿµԿ棺ԿΪϣƬÿƬһһLRU
+// ʱֻһβƶδʱչԿٲ롣
+// ڴԤ̭ԿͻеԿ㣻
+// ص shared_ptr ڱ̭ȻЧһͷʱ
+class sm4_key_cache {
+public:
+    // ÿĹ㿪ԿԿڵ㡢ϣڵ shared_ptr ƿ
+    static constexpr size_t ENTRY_COST = sizeof(sm4_key_schedule) + 16 + 8 * sizeof(void*);
+
+    // Ԥ㲻ÿƬһʱٷƬʹԤ㣻Ԥ㲻һʱ棬ÿζֳչ
+    explicit sm4_key_cache(size_t memory_budget, size_t shard_count = 16)
+        : shards(min(max<size_t>(shard_count, 1), max<size_t>(memory_budget / ENTRY_COST, 1))) {
+        shard_capacity = memory_budget / ENTRY_COST / shards.size();
+        random_device rd;
+        seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+        for (shard& s : shards) {
+            s.index = index_map(0, key_hash(seed));
+        }
+    }
+
+    sm4_key_cache(const sm4_key_cache&) = delete;
+    sm4_key_cache& operator=(const sm4_key_cache&) = delete;
+
+    ~sm4_key_cache() {
+        clear();
+    }
+
+    shared_ptr<const sm4_key_schedule> get(const uint8_t key[16]) {
+        shard& s = shards[hash_key(key) % shards.size()];
+        {
+            lock_guard<mutex> lock(s.guard);
+            auto it = s.index.find(key);
+            if (it != s.index.end()) {
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                hit_count.fetch_add(1, memory_order_relaxed);
+                return it->second->schedule;
+            }
+        }
+        miss_count.fetch_add(1, memory_order_relaxed);
+        shared_ptr<sm4_key_schedule> schedule(new sm4_key_schedule, [](sm4_key_schedule* p) {
+            sm4_secure_wipe(p, sizeof(*p));
+            delete p;
+        });
+        sm4_expand_schedule(key, *schedule);
+
+        lock_guard<mutex> lock(s.guard);
+        // չڼ߳̿ѾͬһԿ
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return it->second->schedule;
+        }
+        s.lru.emplace_front();
+        entry& e = s.lru.front();
+        memcpy(e.key.data(), key, 16);
+        e.schedule = schedule;
+        s.index.emplace(e.key.data(), s.lru.begin());
+        while (s.lru.size() > shard_capacity) {
+            evict_last(s);
+        }
+        return schedule;
+    }
+
+    void clear() {
+        for (shard& s : shards) {
+            lock_guard<mutex> lock(s.guard);
+            while (!s.lru.empty()) {
+                evict_last(s);
+            }
+        }
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (shard& s : shards) {
+            lock_guard<mutex> lock(s.guard);
+            total += s.lru.size();
+        }
+        return total;
+    }
+
+    size_t capacity() const {
+        return shard_capacity * shards.size();
+    }
+
+    uint64_t hits() const {
+        return hit_count.load(memory_order_relaxed);
+    }
+
+    uint64_t misses() const {
+        return miss_count.load(memory_order_relaxed);
+    }
+
+private:
+    struct entry {
+        array<uint8_t, 16> key;
+        shared_ptr<const sm4_key_schedule> schedule;
+    };
+
+    // ϣļָڵԿ̭ʱֻһ
+    struct key_hash {
+        key_hash() : seed(0) {}
+        explicit key_hash(uint64_t seed) : seed(seed) {}
+        uint64_t seed;
+        size_t operator()(const uint8_t* key) const {
+            return static_cast<size_t>(mix_key(key, seed));
+        }
+    };
+
+    struct key_equal {
+        bool operator()(const uint8_t* a, const uint8_t* b) const {
+            return memcmp(a, b, 16) == 0;
+        }
+    };
+
+    using index_map = unordered_map<const uint8_t*, list<entry>::iterator, key_hash, key_equal>;
+
+    struct shard {
+        mutex guard;
+        list<entry> lru;
+        index_map index;
+    };
+
+    // ӵ64λϣⰴԤԿϣͻ
+    static uint64_t mix_key(const uint8_t* key, uint64_t seed) {
+        uint64_t lo, hi;
+        memcpy(&lo, key, 8);
+        memcpy(&hi, key + 8, 8);
+        uint64_t h = seed ^ lo;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h ^= hi;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        return h ^ (h >> 31);
+    }
+
+    uint64_t hash_key(const uint8_t* key) const {
+        return mix_key(key, seed ^ 0x9E3779B97F4A7C15ULL);
+    }
+
+    void evict_last(shard& s) {
+        entry& e = s.lru.back();
+        s.index.erase(e.key.data());
+        sm4_secure_wipe(e.key.data(), e.key.size());
+        s.lru.pop_back();
+    }
+
+    vector<shard> shards;
+    size_t shard_capacity;
+    uint64_t seed;
+    atomic<uint64_t> hit_count{ 0 };
+    atomic<uint64_t> miss_count{ 0 };
+};
+
+// ͨȡԿĵӽ
+inline void sm4_encrypt(const uint8_t plaintext[16], const uint8_t key[16], uint8_t ciphertext[16], sm4_key_cache& cache) {
+    shared_ptr<const sm4_key_schedule> schedule = cache.get(key);
+    sm4_crypt_block(plaintext, schedule->encrypt, false, ciphertext);
+}
+
+inline void sm4_decrypt(const uint8_t ciphertext[16], const uint8_t key[16], uint8_t plaintext[16], sm4_key_cache& cache) {
+    shared_ptr<const sm4_key_schedule> schedule = cache.get(key);
+    sm4_crypt_block(ciphertext, schedule->decrypt, false, plaintext);
+}
+
+// ---- 鴦CBC ----
+// SԱ任 L ϳһűL ֻѭλɣֽλõѭλɽ
+//  T(x) = L((x)) ĸֽڸԲ SM4_T[b] ֽλ 081624 λ
+inline const uint32_t* sm4_round_table() {
+    static const array<uint32_t, 256> table = [] {
+        array<uint32_t, 256> t;
+        for (int b = 0; b < 256; ++b) {
+            t[b] = linear_transform(static_cast<uint32_t>(SBox[b]) << 24);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+inline uint32_t sm4_table_transform(const uint32_t* table, uint32_t x) {
+    return table[x >> 24] ^
+        sm4_left_rotate(table[(x >> 16) & 0xFF], 24) ^
+        sm4_left_rotate(table[(x >> 8) & 0xFF], 16) ^
+        sm4_left_rotate(table[x & 0xFF], 8);
+}
+
+// ͬʱķִֺпòλӳٻڸ
+constexpr int SM4_LANES = 8;
+
+//  round_keys ˳ lanes (<= SM4_LANES) 飬ʱ뵹Կ
+inline void sm4_crypt_lanes(const uint8_t* input, const uint32_t round_keys[SM4_ROUNDS], uint8_t* output, int lanes) {
+    const uint32_t* table = sm4_round_table();
+    uint32_t x0[SM4_LANES], x1[SM4_LANES], x2[SM4_LANES], x3[SM4_LANES];
+    for (int l = 0; l < lanes; ++l) {
+        const uint8_t* block = input + l * SM4_BLOCK_SIZE;
+        x0[l] = load_word(block);
+        x1[l] = load_word(block + 4);
+        x2[l] = load_word(block + 8);
+        x3[l] = load_word(block + 12);
+    }
+    // ÿĸֻչֺҪƱ
+    for (int r = 0; r < SM4_ROUNDS; r += 4) {
+        for (int l = 0; l < lanes; ++l) {
+            x0[l] ^= sm4_table_transform(table, x1[l] ^ x2[l] ^ x3[l] ^ round_keys[r]);
+            x1[l] ^= sm4_table_transform(table, x2[l] ^ x3[l] ^ x0[l] ^ round_keys[r + 1]);
+            x2[l] ^= sm4_table_transform(table, x3[l] ^ x0[l] ^ x1[l] ^ round_keys[r + 2]);
+            x3[l] ^= sm4_table_transform(table, x0[l] ^ x1[l] ^ x2[l] ^ round_keys[r + 3]);
+        }
+    }
+    for (int l = 0; l < lanes; ++l) {
+        uint8_t* block = output + l * SM4_BLOCK_SIZE;
+        store_word(x3[l], block);
+        store_word(x2[l], block + 4);
+        store_word(x1[l], block + 8);
+        store_word(x0[l], block + 12);
+    }
+}
+
+inline void sm4_xor_block(uint8_t* data, const uint8_t* mask) {
+    for (int i = 0; i < SM4_BLOCK_SIZE; ++i) {
+        data[i] ^= mask[i];
+    }
+}
+
+// CBCܣC_i = E(P_i  C_{i-1})C_0 ǰһΪ IVÿһģֻܴС
+// length Ϊ16ıɵ÷output  input ͬ
+inline bool sm4_cbc_encrypt(const uint8_t* input, size_t length, const uint8_t iv[16], const sm4_key_schedule& schedule, uint8_t* output) {
+    if (length % SM4_BLOCK_SIZE != 0) {
+        return false;
+    }
+    uint8_t chain[SM4_BLOCK_SIZE];
+    memcpy(chain, iv, SM4_BLOCK_SIZE);
+    for (size_t pos = 0; pos < length; pos += SM4_BLOCK_SIZE) {
+        sm4_xor_block(chain, input + pos);
+        sm4_crypt_block(chain, schedule.encrypt, false, output + pos);
+        memcpy(chain, output + pos, SM4_BLOCK_SIZE);
+    }
+    return true;
+}
+
+//  [first, last) Χڵķ飬previous Ϊ first ǰһģIV
+// ÿ SM4_LANES Ƚܵʱǰһд output  input ͬʱҲѸǵ
+inline void sm4_cbc_decrypt_range(const uint8_t* input, const uint32_t round_keys[SM4_ROUNDS], const uint8_t previous[16], uint8_t* output,
+    size_t first, size_t last) {
+    uint8_t chain[SM4_BLOCK_SIZE];
+    uint8_t buffer[SM4_LANES * SM4_BLOCK_SIZE];
+    memcpy(chain, previous, SM4_BLOCK_SIZE);
+    for (size_t i = first; i < last; i += SM4_LANES) {
+        int lanes = static_cast<int>(min<size_t>(SM4_LANES, last - i));
+        const uint8_t* in = input + i * SM4_BLOCK_SIZE;
+        uint8_t* out = output + i * SM4_BLOCK_SIZE;
+        // ʱԳãѭ SM4_LANES ȫչ
+        if (lanes == SM4_LANES) {
+            sm4_crypt_lanes(in, round_keys, buffer, SM4_LANES);
+        }
+        else {
+            sm4_crypt_lanes(in, round_keys, buffer, lanes);
+        }
+        sm4_xor_block(buffer, chain);
+        for (int l = 1; l < lanes; ++l) {
+            sm4_xor_block(buffer + l * SM4_BLOCK_SIZE, in + (l - 1) * SM4_BLOCK_SIZE);
+        }
+        memcpy(chain, in + (lanes - 1) * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+        memcpy(out, buffer, lanes * SM4_BLOCK_SIZE);
+    }
+    sm4_secure_wipe(buffer, sizeof(buffer));
+}
+
+// ÿ߳ٷֵķСֱڵǰ߳ɣ̴߳
+constexpr size_t SM4_CBC_MIN_BLOCKS_PER_THREAD = 1 << 14;
+
+// CBCܣP_i = D(C_i)  C_{i-1}ÿֻģԳ齻ָ̡ܲ߳
+// ߳ǰһǰȸƳoutput  input ͬԭؽܣ򻥲صʱȷ
+inline bool sm4_cbc_decrypt(const uint8_t* input, size_t length, const uint8_t iv[16], const sm4_key_schedule& schedule, uint8_t* output,
+    unsigned thread_count = thread::hardware_concurrency()) {
+    if (length % SM4_BLOCK_SIZE != 0) {
+        return false;
+    }
+    size_t blocks = length / SM4_BLOCK_SIZE;
+    if (blocks == 0) {
+        return true;
+    }
+    size_t threads = min<size_t>(max(thread_count, 1u), max<size_t>(1, blocks / SM4_CBC_MIN_BLOCKS_PER_THREAD));
+    size_t per_thread = (blocks + threads - 1) / threads;
+    vector<array<uint8_t, SM4_BLOCK_SIZE>> previous(threads);
+    memcpy(previous[0].data(), iv, SM4_BLOCK_SIZE);
+    for (size_t t = 1; t < threads; ++t) {
+        memcpy(previous[t].data(), input + (t * per_thread - 1) * SM4_BLOCK_SIZE, SM4_BLOCK_SIZE);
+    }
+    vector<thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        size_t first = t * per_thread;
+        size_t last = min(first + per_thread, blocks);
+        workers.emplace_back(sm4_cbc_decrypt_range, input, schedule.decrypt, previous[t].data(), output, first, last);
+    }
+    sm4_cbc_decrypt_range(input, schedule.decrypt, previous[0].data(), output, 0, min(per_thread, blocks));
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return true;
+}
+
+#endif
\ No newline at end of file
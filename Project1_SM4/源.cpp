@@ -5,123 +5,105 @@
 #include <ctime>
 #include <iomanip>
 #include <chrono>
+#include <random>
+#include "sm4.h"
 
 using namespace std;
 using namespace std::chrono;
 
-const uint8_t SBox[256] = {
-    0xD6, 0x90, 0xE9, 0xFE, 0xCC, 0xE1, 0x3D, 0xB7,
-    0x16, 0xB6, 0x14, 0xC2, 0x28, 0xFB, 0x2C, 0x05,
-    0x2B, 0x67, 0x9A, 0x76, 0x2A, 0xBE, 0x04, 0xC3,
-    0xAA, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
-    0x9C, 0x42, 0x50, 0xF4, 0x91, 0xEF, 0x98, 0x7A,
-    0x33, 0x54, 0x0B, 0x43, 0xED, 0xCF, 0xAC, 0x62,
-    0xE4, 0xB3, 0x1C, 0xA9, 0xC9, 0x08, 0xE8, 0x95,
-    0x80, 0xDF, 0x94, 0xFA, 0x75, 0x8F, 0x3F, 0xA6,
-    0x47, 0x07, 0xA7, 0xFC, 0xF3, 0x73, 0x17, 0xBA,
-    0x83, 0x59, 0x3C, 0x19, 0xE6, 0x85, 0x4F, 0xA8,
-    0x68, 0x6B, 0x81, 0xB2, 0x71, 0x64, 0xDA, 0x8B,
-    0xF8, 0xEB, 0x0F, 0x4B, 0x70, 0x56, 0x9D, 0x35,
-    0x1E, 0x24, 0x0E, 0x5E, 0x63, 0x58, 0xD1, 0xA2,
-    0x25, 0x22, 0x7C, 0x3B, 0x01, 0x21, 0x78, 0x87,
-    0xD4, 0x00, 0x46, 0x57, 0x9F, 0xD3, 0x27, 0x52,
-    0x4C, 0x36, 0x02, 0xE7, 0xA0, 0xC4, 0xC8, 0x9E,
-    0xEA, 0xBF, 0x8A, 0xD2, 0x40, 0xC7, 0x38, 0xB5,
-    0xA3, 0xF7, 0xF2, 0xCE, 0xF9, 0x61, 0x15, 0xA1,
-    0xE0, 0xAE, 0x5D, 0xA4, 0x9B, 0x34, 0x1A, 0x55,
-    0xAD, 0x93, 0x32, 0x30, 0xF5, 0x8C, 0xB1, 0xE3,
-    0x1D, 0xF6, 0xE2, 0x2E, 0x82, 0x66, 0xCA, 0x60,
-    0xC0, 0x29, 0x23, 0xAB, 0x0D, 0x53, 0x4E, 0x6F,
-    0xD5, 0xDB, 0x37, 0x45, 0xDE, 0xFD, 0x8E, 0x2F,
-    0x03, 0xFF, 0x6A, 0x72, 0x6D, 0x6C, 0x5B, 0x51,
-    0x8D, 0x1B, 0xAF, 0x92, 0xBB, 0xDD, 0xBC, 0x7F,
-    0x11, 0xD9, 0x5C, 0x41, 0x1F, 0x10, 0x5A, 0xD8,
-    0x0A, 0xC1, 0x31, 0x88, 0xA5, 0xCD, 0x7B, 0xBD,
-    0x2D, 0x74, 0xD0, 0x12, 0xB8, 0xE5, 0xB4, 0xB0,
-    0x89, 0x69, 0x97, 0x4A, 0x0C, 0x96, 0x77, 0x7E,
-    0x65, 0xB9, 0xF1, 0x09, 0xC5, 0x6E, 0xC6, 0x84,
-    0x18, 0xF0, 0x7D, 0xEC, 0x3A, 0xDC, 0x4D, 0x20,
-    0x79, 0xEE, 0x5F, 0x3E, 0xD7, 0xCB, 0x39, 0x48
-};
-
-const uint32_t Fk[4] = {
-    0xA3B1BAC6,
-    0x56AA3350,
-    0x677D9197,
-    0xB27022DC
-};
-
-uint32_t left_rotate(uint32_t value, int bits) {
-    return (value << bits) | (value >> (32 - bits));
+void print_hex(const uint8_t data[16]) {
+    for (int i = 0; i < 16; ++i) {
+        cout << hex << setw(2) << setfill('0') << static_cast<int>(data[i]);
+    }
+    cout << dec << endl;
 }
 
-vector<uint32_t> key_expansion(const uint8_t key[16]) {
-    vector<uint32_t> round_keys;
-    uint32_t temp = 0;
-    for (int i = 0; i < 4; ++i) {
-        temp |= static_cast<uint32_t>(key[i]) << (8 * (3 - i));
-    }
-    round_keys.push_back(temp);
-    for (int i = 1; i < 32; ++i) {
-        temp = temp ^ left_rotate(temp, 8);
-        if (i % 4 == 0) {
-            temp = temp ^ Fk[i / 4 - 1];
+// ģ⻧ÿĳ⻧Կһ飬⻧ࡣ
+// ȽÿζչԿͨȡԿĺʱ
+void run_key_cache_demo() {
+    constexpr int tenant_count = 1000;
+    constexpr int request_count = 200000;
+    mt19937 gen(12345);
+    vector<array<uint8_t, 16>> tenant_keys(tenant_count);
+    for (auto& key : tenant_keys) {
+        for (auto& b : key) {
+            b = static_cast<uint8_t>(gen());
         }
-        round_keys.push_back(temp);
     }
-    return round_keys;
-}
-
-uint32_t nonlinear_transform(uint32_t word) {
-    uint32_t result = 0;
-    for (int i = 0; i < 4; ++i) {
-        result |= static_cast<uint32_t>(SBox[(word >> (8 * (3 - i))) & 0xFF]) << (8 * (3 - i));
+    // ȡ u^3 ʹڱС⻧
+    uniform_real_distribution<double> dis(0.0, 1.0);
+    vector<int> requests(request_count);
+    for (auto& tenant : requests) {
+        double u = dis(gen);
+        tenant = static_cast<int>(tenant_count * u * u * u);
     }
-    return result;
-}
-
-uint32_t linear_transform(uint32_t word) {
-    uint32_t result = word;
-    result = result ^ (left_rotate(result, 13));
-    result = result ^ (left_rotate(result, 23));
-    return result;
-}
 
-uint32_t round_function(uint32_t input, uint32_t round_key) {
-    uint32_t output = input ^ round_key;
-    output = nonlinear_transform(output);
-    output = linear_transform(output);
-    return output;
-}
-
-void sm4_encrypt(const uint8_t plaintext[16], const uint8_t key[16], uint8_t ciphertext[16]) {
-    vector<uint32_t> round_keys = key_expansion(key);
-    uint32_t data[4];
-    for (int i = 0; i < 4; ++i) {
-        data[i] = (static_cast<uint32_t>(plaintext[i]) << 24) |
-            (static_cast<uint32_t>(plaintext[i + 4]) << 16) |
-            (static_cast<uint32_t>(plaintext[i + 8]) << 8) |
-            static_cast<uint32_t>(plaintext[i + 12]);
+    uint8_t block[16] = { 0 };
+    uint8_t ciphertext[16];
+    uint8_t uncached_check = 0;
+    auto start = high_resolution_clock::now();
+    for (int tenant : requests) {
+        sm4_encrypt(block, tenant_keys[tenant].data(), ciphertext);
+        uncached_check ^= ciphertext[0];
     }
-    for (int r = 0; r < 32; ++r) {
-        data[0] = round_function(data[0], round_keys[r]);
-        data[1] = round_function(data[1], round_keys[r]);
-        data[2] = round_function(data[2], round_keys[r]);
-        data[3] = round_function(data[3], round_keys[r]);
+    auto middle = high_resolution_clock::now();
+
+    // Ԥֻһ⻧Կ
+    sm4_key_cache cache(tenant_count / 2 * sm4_key_cache::ENTRY_COST);
+    uint8_t cached_check = 0;
+    for (int tenant : requests) {
+        sm4_encrypt(block, tenant_keys[tenant].data(), ciphertext, cache);
+        cached_check ^= ciphertext[0];
     }
-    for (int i = 0; i < 4; ++i) {
-        ciphertext[i] = (data[i] >> 24) & 0xFF;
-        ciphertext[i + 4] = (data[i] >> 16) & 0xFF;
-        ciphertext[i + 8] = (data[i] >> 8) & 0xFF;
-        ciphertext[i + 12] = data[i] & 0xFF;
+    auto end = high_resolution_clock::now();
+
+    chrono::duration<double, milli> uncached_time = middle - start;
+    chrono::duration<double, milli> cached_time = end - middle;
+    cout << tenant_count << " ⻧Կ" << request_count << " ÿչԿ " << uncached_time.count() << " msʹû "
+        << cached_time.count() << " ms " << cache.size() << "/" << cache.capacity() << "  " << cache.hits() << " Σδ "
+        << cache.misses() << " Σ" << (uncached_check == cached_check ? "һ" : "һ") << endl;
+
+    // Ԥֻ3ʱƬ֮3ᳬԤ
+    sm4_key_cache tiny(3 * sm4_key_cache::ENTRY_COST);
+    for (const auto& key : tenant_keys) {
+        tiny.get(key.data());
     }
+    cout << "ԤΪ 3 Ļ棺 " << tiny.capacity() << "  " << tenant_count << " Կʵ " << tiny.size() << " " << endl;
 }
 
-void print_hex(const uint8_t data[16]) {
-    for (int i = 0; i < 16; ++i) {
-        cout << hex << setw(2) << setfill('0') << static_cast<int>(data[i]);
+// CBCһδݺֱ鴮нܺͳ齻߳̽ܣȽϺʱ˶Խ
+void run_cbc_demo(const uint8_t key[16]) {
+    constexpr size_t data_size = 32 << 20;
+    sm4_key_schedule schedule;
+    sm4_expand_schedule(key, schedule);
+    mt19937 gen(2024);
+    vector<uint8_t> plaintext(data_size);
+    for (auto& b : plaintext) {
+        b = static_cast<uint8_t>(gen());
     }
-    cout << dec << endl;
+    uint8_t iv[16];
+    for (auto& b : iv) {
+        b = static_cast<uint8_t>(gen());
+    }
+    vector<uint8_t> ciphertext(data_size);
+    sm4_cbc_encrypt(plaintext.data(), data_size, iv, schedule, ciphertext.data());
+
+    vector<uint8_t> serial(data_size);
+    auto start = high_resolution_clock::now();
+    for (size_t pos = 0; pos < data_size; pos += SM4_BLOCK_SIZE) {
+        sm4_crypt_block(ciphertext.data() + pos, schedule.encrypt, true, serial.data() + pos);
+        sm4_xor_block(serial.data() + pos, pos == 0 ? iv : ciphertext.data() + pos - SM4_BLOCK_SIZE);
+    }
+    auto middle = high_resolution_clock::now();
+    vector<uint8_t> parallel(data_size);
+    sm4_cbc_decrypt(ciphertext.data(), data_size, iv, schedule, parallel.data());
+    auto end = high_resolution_clock::now();
+
+    chrono::duration<double, milli> serial_time = middle - start;
+    chrono::duration<double, milli> parallel_time = end - middle;
+    bool matches = serial == plaintext && parallel == plaintext;
+    cout << "CBC " << (data_size >> 20) << " MB鴮 " << serial_time.count() << " ms " << SM4_LANES << " 鲢ʹ "
+        << thread::hardware_concurrency() << " ߳ " << parallel_time.count() << " ms" << (matches ? "һ" : "һ") << endl;
 }
 
 int main() {
@@ -160,6 +142,11 @@ int main() {
 
         cout << ": ";
         print_hex(ciphertext);
+
+        uint8_t decrypted[16];
+        sm4_decrypt(ciphertext, key, decrypted);
+        cout << ": ";
+        print_hex(decrypted);
     }
 
     double average_time = total_time / iterations;
@@ -167,5 +154,8 @@ int main() {
     cout << "ܼʱ: " << total_time << " ms" << endl;
     cout << "ƽʱ: " << average_time << " ms" << endl;
 
+    run_key_cache_demo();
+    run_cbc_demo(key);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "avx2_kernels.h"
+#include <immintrin.h>
+
+// MSVC ͨжԱļõ /arch:AVX2  AVX2 ָGCC/Clang  target ֻ
+// ಿ԰ָ룬ڲ֧ AVX2  CPU Ҳ
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+AVX2_TARGET int blendBytesAvx2(unsigned char* p, int count, float alpha) {
+    // ÿδ32ֽڣչΪ48floatˣȡٱѹֽ
+    __m256 scale = _mm256_set1_ps(alpha);
+    int x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x + 16));
+        __m256i v0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo)), scale));
+        __m256i v1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8))), scale));
+        __m256i v2 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi)), scale));
+        __m256i v3 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8))), scale));
+        // packs/packus ÿ128λͨڽ permutevar8x32 ָԭ˳
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + x), packed);
+    }
+    return x;
+}
+
+AVX2_TARGET int countChangedBgrAvx2(const unsigned char* pa, const unsigned char* pb, int cols, int limit, int& changed) {
+    // ÿδ8أ16ֽڼظȡ4أֽʹÿصBGRռһ32λͨ
+    // ڶμػԽ8ض4ֽڣֻڸлʣ10ʱ·
+    const __m256i gather = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i weightB = _mm256_set1_epi32(GRAY_B2Y);
+    const __m256i weightG = _mm256_set1_epi32(GRAY_G2Y);
+    const __m256i weightR = _mm256_set1_epi32(GRAY_R2Y);
+    const __m256i bound = _mm256_set1_epi32(limit - 1);
+    int x = 0;
+    for (; x + 10 <= cols; x += 8) {
+        __m256i va = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + x * 3))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + x * 3 + 12)), 1);
+        __m256i vb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + x * 3))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + x * 3 + 12)), 1);
+        va = _mm256_shuffle_epi8(va, gather);
+        vb = _mm256_shuffle_epi8(vb, gather);
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        __m256i sum = _mm256_mullo_epi32(_mm256_and_si256(diff, byteMask), weightB);
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(diff, 8), byteMask), weightG));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_srli_epi32(diff, 16), weightR));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(sum, bound)));
+        for (; mask != 0; mask &= mask - 1) {
+            ++changed;
+        }
+    }
+    return x;
+}
\ No newline at end of file
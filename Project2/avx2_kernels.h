@@ -0,0 +1,16 @@
+#ifndef AVX2_KERNELS_H
+#define AVX2_KERNELS_H
+
+// ɼˮӡȵѭ AVX2 汾ʵ avx2_kernels.cpp е AVX2 룬
+// ÷ cv::checkHardwareSupport(CV_CPU_AVX2) ȷ CPU ֧֣ٵĺ
+
+// cvtColor(COLOR_BGR2GRAY) ʹõ14λҶϵ
+const int GRAY_B2Y = 1868, GRAY_G2Y = 9617, GRAY_R2Y = 4899, GRAY_SHIFT = 14;
+
+//  p  count ֽ alpha ֽڣֻ32ֽڵ飬Ѵֽʣಿɵ÷
+int blendBytesAvx2(unsigned char* p, int count, float alpha);
+
+// ͳһ BGR мȨҶȲ >= limit ۼӵ changedѴʣಿɵ÷
+int countChangedBgrAvx2(const unsigned char* pa, const unsigned char* pb, int cols, int limit, int& changed);
+
+#endif
\ No newline at end of file
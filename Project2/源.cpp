@@ -1,112 +1,2072 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <sstream>
+#include <climits>
+#include <set>
+#include "../Project4_sm3/sm3.h"
+#include "../Project1_SM4/sm4.h"
+#include "avx2_kernels.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace cv;
 using namespace std;
 
-// ˮӡ
-void addWatermark(const Mat& src, Mat& dst, const string& watermarkText) {
-    dst = src.clone();
+// ɼˮӡİ͸½ֻϸ30ء200صľΣͼĲֱõ
+Rect visibleWatermarkRegion(const Mat& image) {
+    return Rect(image.cols - 200, image.rows - 60, 200, 30) & Rect(0, 0, image.cols, image.rows);
+}
+
+// ʱһ CPU Ƿ֧ AVX2֧ʱȵѭ߱·
+static const bool avx2Available = checkHardwareSupport(CV_CPU_AVX2);
+
+// ɼˮӡİ͸ϣregion ȫڰ alpha : (1 - alpha) ϣÿ alpha 루뵽ż
+//  convertTo(region, -1, alpha, 0) Ľͬе鴦ʱͼ
+void blendWatermarkRegion(Mat& region, float alpha) {
+    CV_Assert(region.depth() == CV_8U);
+    int rowBytes = region.cols * region.channels();
+    for (int y = 0; y < region.rows; ++y) {
+        uchar* p = region.ptr<uchar>(y);
+        int x = avx2Available ? blendBytesAvx2(p, rowBytes, alpha) : 0;
+        for (; x < rowBytes; ++x) {
+            p[x] = saturate_cast<uchar>(p[x] * alpha);
+        }
+    }
+}
 
+// ͳͬС 8 λͼлҶȲ thresholdValue 
+//  absdiff  cvtColor(COLOR_BGR2GRAY)  threshold(THRESH_BINARY)  countNonZero Ľͬ
+// еɣκмͼ񡣻Ҷʹ cvtColor ͬ14λϵ
+int countChangedPixels(const Mat& a, const Mat& b, int thresholdValue) {
+    CV_Assert(a.size() == b.size() && a.type() == b.type() && a.depth() == CV_8U && (a.channels() == 1 || a.channels() == 3 || a.channels() == 4));
+    const int B2Y = GRAY_B2Y, G2Y = GRAY_G2Y, R2Y = GRAY_R2Y, SHIFT = GRAY_SHIFT;
+    int cn = a.channels();
+    // Ҷ > thresholdValue ȼڶȨ +  >= (thresholdValue + 1) << SHIFT
+    int limit = ((thresholdValue + 1) << SHIFT) - (1 << (SHIFT - 1));
+    int count = 0;
+    for (int y = 0; y < a.rows; ++y) {
+        const uchar* pa = a.ptr<uchar>(y);
+        const uchar* pb = b.ptr<uchar>(y);
+        int x = 0;
+        if (cn == 1) {
+            for (; x < a.cols; ++x) {
+                count += abs(pa[x] - pb[x]) > thresholdValue;
+            }
+            continue;
+        }
+        if (cn == 3 && avx2Available) {
+            x = countChangedBgrAvx2(pa, pb, a.cols, limit, count);
+        }
+        for (; x < a.cols; ++x) {
+            const uchar* ca = pa + x * cn;
+            const uchar* cb = pb + x * cn;
+            int sum = abs(ca[0] - cb[0]) * B2Y + abs(ca[1] - cb[1]) * G2Y + abs(ca[2] - cb[2]) * R2Y;
+            count += sum >= limit;
+        }
+    }
+    return count;
+}
+
+// ԭӿɼˮӡֻĶֱʻͰ͸ڵأκͼȴĻ
+bool addWatermarkInPlace(Mat& image, const string& watermarkText) {
+    if (image.empty()) {
+        return false;
+    }
     int fontFace = FONT_HERSHEY_SIMPLEX;
     double fontScale = 1.0;
     int thickness = 2;
     Scalar textColor(255, 255, 255);
-    Point textOrg(dst.cols - 200, dst.rows - 30);
+    Point textOrg(image.cols - 200, image.rows - 30);
+
+    putText(image, watermarkText, textOrg, fontFace, fontScale, textColor, thickness, LINE_AA);
 
-    putText(dst, watermarkText, textOrg, fontFace, fontScale, textColor, thickness, LINE_AA);
+    // ȫͼ 0.7 : 0.3 ϣȼڰڵس0.7
+    Mat roi = image(visibleWatermarkRegion(image));
+    blendWatermarkRegion(roi, 0.7f);
+    return true;
+}
 
-    Rect roi(textOrg.x, textOrg.y - 30, 200, 30);
-    Mat semiTransparent = Mat::zeros(dst.size(), dst.type());
-    addWeighted(dst(roi), 0.7, semiTransparent(roi), 0.3, 0, dst(roi));
+// ˮӡdst  src Сͬʱ÷ԤȷֱӸã
+// dst  src ͬһͼʱƣֱԭ޸
+void addWatermark(const Mat& src, Mat& dst, const string& watermarkText) {
+    if (dst.data != src.data) {
+        src.copyTo(dst);
+    }
+    addWatermarkInPlace(dst, watermarkText);
 }
 
 // ȡˮӡ
 bool extractWatermark(const Mat& src, const Mat& original, string& extractedText) {
-    Rect watermarkRegion(src.cols - 200, src.rows - 30, 200, 30);
-    Mat watermarked = src(watermarkRegion).clone();
-    Mat originalRegion = original(watermarkRegion).clone();
+    Rect watermarkRegion = Rect(src.cols - 200, src.rows - 30, 200, 30) & Rect(0, 0, src.cols, src.rows) & Rect(0, 0, original.cols, original.rows);
+    if (watermarkRegion.empty()) {
+        extractedText = "No watermark detected";
+        return false;
+    }
+    // ֵתҶȺֵΪ50ͳƱ仯
+    int nonZeroCount = countChangedPixels(src(watermarkRegion), original(watermarkRegion), 50);
+    if (nonZeroCount > (watermarkRegion.area() * 0.1)) { // 10%б仯
+        extractedText = "Watermark detected";
+        return true;
+    }
+    else {
+        extractedText = "No watermark detected";
+        return false;
+    }
+}
 
-    Mat diff;
-    absdiff(watermarked, originalRegion, diff);
+// äˮӡȵ 88 DCTƵϵƵǶ룬ȡʱҪԭͼ
+// DCT任ϵ C_k  achip_k ȼڿ a chip_kbasis_k
+// ȡʱ  chip_kC_k ҲڿͬһͼڻǶȡֱڿ򰴿㣬ҪDCT
+// ˮӡΪһƬͼƬеһֿλֻԿͬ飬ڲüƽơת¶λ
+constexpr int WM_BLOCK = 8;
+constexpr int WM_BLOCK_PIXELS = WM_BLOCK * WM_BLOCK;
+constexpr int WM_TILE_BLOCKS = 16;          // غ 1616 飨128128أƬڰԿɢƬظ
+constexpr int WM_TILE_PIXELS = WM_TILE_BLOCKS * WM_BLOCK;
+constexpr int WM_TILE_SLOTS = WM_TILE_BLOCKS * WM_TILE_BLOCKS;
+constexpr int WM_SYNC_SLOTS = 64;           // ͬĸغ
+constexpr int WM_ID_BITS = 48;              // ͻʶλ
+constexpr int WM_TAG_BITS = 32;             // ضϵ HMAC-SM3 ǩͬʱSM4ܱʶʱĳʼ
+constexpr int WM_DATA_BITS = WM_ID_BITS + WM_TAG_BITS;  // װغɣܵıʶӱǩ
+constexpr int WM_BCH_M = 7;                 // BCH붨 GF(2^7) ϣ볤 127
+constexpr int WM_BCH_N = (1 << WM_BCH_M) - 1;
+constexpr int WM_BCH_T = 6;                 // ɾĴλ
+constexpr int WM_PARITY_BITS = WM_BCH_M * WM_BCH_T;
+constexpr int WM_PAYLOAD_BITS = WM_DATA_BITS + WM_PARITY_BITS;  // Ƕλ̵ BCH(122, 80) ֣Ƭÿһλظ12
+constexpr float WM_DEFAULT_STRENGTH = 5.0f; // ÿƵϵǶ
+constexpr float WM_DETECT_THRESHOLD = 1.5f; // λһֵֵľֵˮӡʱԼΪ0.8
+constexpr int WM_SYNC_CANDIDATES = 3;       // ͬ󰴷ֵӸߵೢԵλø
+constexpr uint64_t WM_DEMO_SECRET = 0x45757857617465ULL; // ʾԿʵʲʱӦɵ÷ṩ
+constexpr uint64_t WM_DEMO_CUSTOMER = 1005;  // ʾõĿͻʶ
 
-    // תΪҶͼ
-    Mat diffGray;
-    cvtColor(diff, diffGray, COLOR_BGR2GRAY);
+// Ƕʹ u + v Ϊ349ƵϵȱܿԻеĵƵҲܿױJPEGĸƵ
+const int WM_BAND[][2] = {
+    { 0, 3 }, { 1, 2 }, { 2, 1 }, { 3, 0 },
+    { 0, 4 }, { 1, 3 }, { 2, 2 }, { 3, 1 }, { 4, 0 },
+};
+constexpr int WM_BAND_SIZE = sizeof(WM_BAND) / sizeof(WM_BAND[0]);
 
-    // ӦֵԻöֵͼ
-    Mat thresh;
-    threshold(diffGray, thresh, 50, 255, THRESH_BINARY);
+// ԿɵƵƬÿλóصغλͬΪ -1Ϊ syncSign
+// λõĿͼƵDCTͼ 1 ƬȨͣԼͬģַתµƵס
+// ͬģƵֻԿԿʱã֮ÿͼֻһƬСDFT
+struct WatermarkKey {
+    int bitOfSlot[WM_TILE_SLOTS];
+    float syncSign[WM_TILE_SLOTS];
+    float pattern[WM_TILE_SLOTS][WM_BLOCK_PIXELS];
+    Mat syncSpectrum[4];
+};
 
-    // 
-    double nonZeroCount = countNonZero(thresh);
-    if (nonZeroCount > (thresh.rows * thresh.cols * 0.1)) { // 10%б仯
-        extractedText = "Watermark detected";
+// ͼˮӡƬļζӦϵͼ (x, y) ڰ flipXflipY Ƭ
+// ((x + dx) mod WM_TILE_PIXELS, (y + dy) mod WM_TILE_PIXELS) score Ϊͬط̶ȡ
+struct WatermarkAlignment {
+    bool flipX = false;
+    bool flipY = false;
+    int dx = 0;
+    int dy = 0;
+    float score = 0;
+};
+
+// ɾƬиλõͼԼǶӦԭƬλ
+void orientWatermarkPatterns(const WatermarkKey& key, bool flipX, bool flipY, vector<float>& patterns, vector<int>& slots) {
+    patterns.resize(WM_TILE_SLOTS * WM_BLOCK_PIXELS);
+    slots.resize(WM_TILE_SLOTS);
+    for (int by = 0; by < WM_TILE_BLOCKS; ++by) {
+        for (int bx = 0; bx < WM_TILE_BLOCKS; ++bx) {
+            int slot = (flipY ? WM_TILE_BLOCKS - 1 - by : by) * WM_TILE_BLOCKS + (flipX ? WM_TILE_BLOCKS - 1 - bx : bx);
+            slots[by * WM_TILE_BLOCKS + bx] = slot;
+            float* out = &patterns[(by * WM_TILE_BLOCKS + bx) * WM_BLOCK_PIXELS];
+            for (int y = 0; y < WM_BLOCK; ++y) {
+                for (int x = 0; x < WM_BLOCK; ++x) {
+                    int sy = flipY ? WM_BLOCK - 1 - y : y;
+                    int sx = flipX ? WM_BLOCK - 1 - x : x;
+                    out[y * WM_BLOCK + x] = key.pattern[slot][sy * WM_BLOCK + sx];
+                }
+            }
+        }
+    }
+}
+
+// غһƬͼpayload Ϊʱֻͬ鲿֣ͬģ
+void buildWatermarkTile(const WatermarkKey& key, const vector<uint8_t>& payload, bool flipX, bool flipY, float strength, Mat& tile) {
+    vector<float> patterns;
+    vector<int> slots;
+    orientWatermarkPatterns(key, flipX, flipY, patterns, slots);
+    tile.create(WM_TILE_PIXELS, WM_TILE_PIXELS, CV_32FC1);
+    for (int by = 0; by < WM_TILE_BLOCKS; ++by) {
+        for (int bx = 0; bx < WM_TILE_BLOCKS; ++bx) {
+            int slot = slots[by * WM_TILE_BLOCKS + bx];
+            float amplitude = 0;
+            if (key.bitOfSlot[slot] < 0) {
+                amplitude = strength * key.syncSign[slot];
+            }
+            else if (!payload.empty()) {
+                amplitude = payload[key.bitOfSlot[slot]] ? strength : -strength;
+            }
+            const float* pattern = &patterns[(by * WM_TILE_BLOCKS + bx) * WM_BLOCK_PIXELS];
+            for (int y = 0; y < WM_BLOCK; ++y) {
+                float* row = tile.ptr<float>(by * WM_BLOCK + y) + bx * WM_BLOCK;
+                for (int x = 0; x < WM_BLOCK; ++x) {
+                    row[x] = amplitude * pattern[y * WM_BLOCK + x];
+                }
+            }
+        }
+    }
+}
+
+void initWatermarkKey(WatermarkKey& key, uint64_t secret) {
+    float basis[WM_BAND_SIZE][WM_BLOCK_PIXELS];
+    for (int k = 0; k < WM_BAND_SIZE; ++k) {
+        int u = WM_BAND[k][0];
+        int v = WM_BAND[k][1];
+        double cu = u == 0 ? sqrt(1.0 / WM_BLOCK) : sqrt(2.0 / WM_BLOCK);
+        double cv = v == 0 ? sqrt(1.0 / WM_BLOCK) : sqrt(2.0 / WM_BLOCK);
+        for (int y = 0; y < WM_BLOCK; ++y) {
+            for (int x = 0; x < WM_BLOCK; ++x) {
+                basis[k][y * WM_BLOCK + x] = static_cast<float>(cu * cos((2 * y + 1) * u * CV_PI / (2 * WM_BLOCK)) *
+                    cv * cos((2 * x + 1) * v * CV_PI / (2 * WM_BLOCK)));
+            }
+        }
+    }
+
+    mt19937_64 gen(secret);
+    vector<int> slots(WM_TILE_SLOTS);
+    for (int i = 0; i < WM_TILE_SLOTS; ++i) {
+        slots[i] = i < WM_SYNC_SLOTS ? -1 : (i - WM_SYNC_SLOTS) % WM_PAYLOAD_BITS;
+    }
+    shuffle(slots.begin(), slots.end(), gen);
+    for (int s = 0; s < WM_TILE_SLOTS; ++s) {
+        key.bitOfSlot[s] = slots[s];
+        key.syncSign[s] = (gen() & 1) ? 1.0f : -1.0f;
+        fill(key.pattern[s], key.pattern[s] + WM_BLOCK_PIXELS, 0.0f);
+        for (int k = 0; k < WM_BAND_SIZE; ++k) {
+            float chip = (gen() & 1) ? 1.0f : -1.0f;
+            for (int i = 0; i < WM_BLOCK_PIXELS; ++i) {
+                key.pattern[s][i] += chip * basis[k][i];
+            }
+        }
+    }
+
+    for (int orientation = 0; orientation < 4; ++orientation) {
+        Mat tile;
+        buildWatermarkTile(key, vector<uint8_t>(), (orientation & 1) != 0, (orientation & 2) != 0, 1.0f, tile);
+        dft(tile, key.syncSpectrum[orientation], DFT_COMPLEX_OUTPUT);
+    }
+}
+
+// غɵľ룺GF(2^7) Ͼ6λıԭBCH (127, 85)Ϊ (122, 80)ߵ5Ϣλ̶Ϊ0Ҳ䡣
+// ֵĵ b λӦʽ x^(WM_PAYLOAD_BITS - 1 - b) ϵǰ WM_DATA_BITS λΪϢλΪУλ
+struct BchCode {
+    int alphaTo[WM_BCH_N + 1];      // ^i
+    int indexOf[WM_BCH_N + 1];      // log_(x)indexOf[0] 
+    uint8_t generator[WM_PARITY_BITS + 1];  // ɶʽϵgenerator[i] Ϊ x^i ϵ
+};
+
+const BchCode& watermarkBchCode() {
+    static const BchCode code = []() {
+        BchCode c;
+        // ԭʽ x^7 + x^3 + 1
+        for (int i = 0, value = 1; i < WM_BCH_N; ++i) {
+            c.alphaTo[i] = value;
+            c.indexOf[value] = i;
+            value <<= 1;
+            if (value & (1 << WM_BCH_M)) {
+                value ^= 0x89;
+            }
+        }
+        c.alphaTo[WM_BCH_N] = c.alphaTo[0];
+        c.indexOf[0] = -1;
+        // ɶʽΪ ^1, ^3, ..., ^(2t-1) 乲ΪСʽ֮
+        vector<bool> isRoot(WM_BCH_N, false);
+        for (int i = 1; i < 2 * WM_BCH_T; i += 2) {
+            for (int r = i; !isRoot[r]; r = r * 2 % WM_BCH_N) {
+                isRoot[r] = true;
+            }
+        }
+        vector<int> g(1, 1);
+        for (int r = 0; r < WM_BCH_N; ++r) {
+            if (!isRoot[r]) {
+                continue;
+            }
+            // g(x)  g(x)  (x + ^r)
+            vector<int> next(g.size() + 1, 0);
+            for (size_t i = 0; i < g.size(); ++i) {
+                next[i + 1] ^= g[i];
+                if (g[i] != 0) {
+                    next[i] ^= c.alphaTo[(c.indexOf[g[i]] + r) % WM_BCH_N];
+                }
+            }
+            g.swap(next);
+        }
+        CV_Assert(g.size() == WM_PARITY_BITS + 1);
+        for (int i = 0; i <= WM_PARITY_BITS; ++i) {
+            CV_Assert(g[i] == 0 || g[i] == 1);
+            c.generator[i] = static_cast<uint8_t>(g[i]);
+        }
+        return c;
+    }();
+    return code;
+}
+
+// ϵͳ룺УλΪ m(x)x^(n-k) ɶʽʽ
+void bchEncode(const uint8_t data[WM_DATA_BITS], uint8_t codeword[WM_PAYLOAD_BITS]) {
+    const BchCode& code = watermarkBchCode();
+    uint8_t parity[WM_PARITY_BITS] = { 0 };  // parity[i] Ϊʽ x^i ϵ
+    for (int b = 0; b < WM_DATA_BITS; ++b) {
+        uint8_t feedback = (data[b] & 1) ^ parity[WM_PARITY_BITS - 1];
+        for (int i = WM_PARITY_BITS - 1; i > 0; --i) {
+            parity[i] = parity[i - 1] ^ (feedback & code.generator[i]);
+        }
+        parity[0] = feedback & code.generator[0];
+    }
+    for (int b = 0; b < WM_DATA_BITS; ++b) {
+        codeword[b] = data[b] & 1;
+    }
+    for (int i = 0; i < WM_PARITY_BITS; ++i) {
+        codeword[WM_PAYLOAD_BITS - 1 - i] = parity[i];
+    }
+}
+
+// ԭؾ WM_BCH_T 󣺼ʽ Berlekamp-Massey λöʽ Chien Ҹ
+// 󳬳ʱܷ֣ĸʽڱ̵λϣʱ false
+bool bchDecode(uint8_t codeword[WM_PAYLOAD_BITS]) {
+    const BchCode& code = watermarkBchCode();
+    int syndrome[2 * WM_BCH_T + 1] = { 0 };
+    bool clean = true;
+    for (int j = 1; j <= 2 * WM_BCH_T; ++j) {
+        for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+            if (codeword[b]) {
+                syndrome[j] ^= code.alphaTo[j * (WM_PAYLOAD_BITS - 1 - b) % WM_BCH_N];
+            }
+        }
+        clean = clean && syndrome[j] == 0;
+    }
+    if (clean) {
         return true;
     }
+
+    auto multiply = [&code](int a, int b) {
+        return a == 0 || b == 0 ? 0 : code.alphaTo[(code.indexOf[a] + code.indexOf[b]) % WM_BCH_N];
+    };
+    auto divide = [&code](int a, int b) {
+        return a == 0 ? 0 : code.alphaTo[(code.indexOf[a] - code.indexOf[b] + WM_BCH_N) % WM_BCH_N];
+    };
+    int locator[2 * WM_BCH_T + 1] = { 1 };
+    int previous[2 * WM_BCH_T + 1] = { 1 };
+    int degree = 0;
+    int shift = 1;
+    int previousDiscrepancy = 1;
+    for (int n = 0; n < 2 * WM_BCH_T; ++n) {
+        int discrepancy = syndrome[n + 1];
+        for (int i = 1; i <= degree; ++i) {
+            discrepancy ^= multiply(locator[i], syndrome[n + 1 - i]);
+        }
+        if (discrepancy == 0) {
+            ++shift;
+            continue;
+        }
+        int saved[2 * WM_BCH_T + 1];
+        copy(locator, locator + 2 * WM_BCH_T + 1, saved);
+        int factor = divide(discrepancy, previousDiscrepancy);
+        for (int i = 0; i + shift <= 2 * WM_BCH_T; ++i) {
+            locator[i + shift] ^= multiply(factor, previous[i]);
+        }
+        if (2 * degree <= n) {
+            degree = n + 1 - degree;
+            copy(saved, saved + 2 * WM_BCH_T + 1, previous);
+            previousDiscrepancy = discrepancy;
+            shift = 1;
+        }
+        else {
+            ++shift;
+        }
+    }
+    if (degree > WM_BCH_T) {
+        return false;
+    }
+
+    // λ p ҽ (^-p) = 0
+    int found = 0;
+    int errors[WM_BCH_T];
+    for (int p = 0; p < WM_BCH_N; ++p) {
+        int value = 0;
+        for (int i = 0; i <= degree; ++i) {
+            if (locator[i] != 0) {
+                value ^= code.alphaTo[(code.indexOf[locator[i]] + (WM_BCH_N - p) * i) % WM_BCH_N];
+            }
+        }
+        if (value == 0) {
+            if (p >= WM_PAYLOAD_BITS || found == WM_BCH_T) {
+                return false;
+            }
+            errors[found++] = p;
+        }
+    }
+    if (found != degree) {
+        return false;
+    }
+    for (int i = 0; i < found; ++i) {
+        codeword[WM_PAYLOAD_BITS - 1 - errors[i]] ^= 1;
+    }
+    return true;
+}
+
+// Ƕäˮӡdata Ϊ WM_DATA_BITS 0/1ֵBCH WM_PAYLOAD_BITS λ
+// BGRͬȵı仯ǡõڸȰغһƬͼٰвеӵͼϡ
+bool embedBlindWatermark(const Mat& src, Mat& dst, const vector<uint8_t>& data, const WatermarkKey& key, float strength = WM_DEFAULT_STRENGTH) {
+    if (src.empty() || src.depth() != CV_8U || src.channels() > 4 || data.size() != WM_DATA_BITS) {
+        return false;
+    }
+    vector<uint8_t> payload(WM_PAYLOAD_BITS);
+    bchEncode(data.data(), payload.data());
+    Mat tile;
+    buildWatermarkTile(key, payload, false, false, strength, tile);
+
+    dst.create(src.size(), src.type());
+    int cn = src.channels();
+    int colorChannels = min(cn, 3);
+    parallel_for_(Range(0, src.rows), [&](const Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float* tileRow = tile.ptr<float>(y % WM_TILE_PIXELS);
+            const uchar* in = src.ptr<uchar>(y);
+            uchar* out = dst.ptr<uchar>(y);
+            for (int x0 = 0; x0 < src.cols; x0 += WM_TILE_PIXELS) {
+                int width = min(WM_TILE_PIXELS, src.cols - x0);
+                const uchar* p = in + x0 * cn;
+                uchar* q = out + x0 * cn;
+                for (int x = 0; x < width; ++x) {
+                    for (int c = 0; c < colorChannels; ++c) {
+                        q[x * cn + c] = saturate_cast<uchar>(p[x * cn + c] + tileRow[x]);
+                    }
+                    for (int c = colorChannels; c < cn; ++c) {
+                        q[x * cn + c] = p[x * cn + c];
+                    }
+                }
+            }
+        }
+    });
+    return true;
+}
+
+// һתΪȣǶʱBGRͬӦ
+inline void lumaRow(const uchar* p, int cn, int count, float* luma) {
+    if (cn == 1) {
+        for (int x = 0; x < count; ++x) {
+            luma[x] = p[x];
+        }
+    }
     else {
-        extractedText = "No watermark detected";
+        for (int x = 0; x < count; ++x) {
+            luma[x] = 0.114f * p[x * cn] + 0.587f * p[x * cn + 1] + 0.299f * p[x * cn + 2];
+        }
+    }
+}
+
+// ͬͼȰƬС۵ۼӣˮӡƬظͬӣͼݲڵģ
+// ӺԼλַתͬģȶԣطλþƽ
+// ۵ֻͼһΣDFTĴС̶ΪһƬͼС޹ء
+// foldWatermarkLuma ۵ۼӵ folded ϣfolded Ϊʱ㣩ƵĶ֡ۼӵͬһ۵ͼС
+bool foldWatermarkLuma(const Mat& src, Mat& folded) {
+    if (src.empty() || src.depth() != CV_8U || src.channels() > 4 || src.rows < WM_BLOCK || src.cols < WM_BLOCK) {
+        return false;
+    }
+    if (folded.empty()) {
+        folded = Mat::zeros(WM_TILE_PIXELS, WM_TILE_PIXELS, CV_32FC1);
+    }
+    int cn = src.channels();
+    // ÿۼӵԼ۵ͼУ˳ϲ߳޹
+    int stripes = max(1, min(src.rows / WM_TILE_PIXELS, 32));
+    vector<Mat> partial(stripes);
+    parallel_for_(Range(0, stripes), [&](const Range& range) {
+        vector<float> luma(src.cols);
+        for (int s = range.start; s < range.end; ++s) {
+            Mat& stripe = partial[s];
+            stripe = Mat::zeros(WM_TILE_PIXELS, WM_TILE_PIXELS, CV_32FC1);
+            int yEnd = static_cast<int>(static_cast<int64_t>(src.rows) * (s + 1) / stripes);
+            for (int y = static_cast<int>(static_cast<int64_t>(src.rows) * s / stripes); y < yEnd; ++y) {
+                lumaRow(src.ptr<uchar>(y), cn, src.cols, luma.data());
+                float* row = stripe.ptr<float>(y % WM_TILE_PIXELS);
+                for (int x0 = 0; x0 < src.cols; x0 += WM_TILE_PIXELS) {
+                    int width = min(WM_TILE_PIXELS, src.cols - x0);
+                    for (int x = 0; x < width; ++x) {
+                        row[x] += luma[x0 + x];
+                    }
+                }
+            }
+        }
+    });
+    for (int s = 0; s < stripes; ++s) {
+        folded += partial[s];
+    }
+    return true;
+}
+
+// ۵ͼλأõط÷ĺѡӦϵ
+void findFoldedAlignment(const Mat& folded, const WatermarkKey& key, vector<WatermarkAlignment>& candidates) {
+    candidates.clear();
+    // ׻ֻ۵ͼƵ׵λʹط岻ͼĵƵû
+    Mat spectrum;
+    dft(folded, spectrum, DFT_COMPLEX_OUTPUT);
+    for (int y = 0; y < spectrum.rows; ++y) {
+        float* p = spectrum.ptr<float>(y);
+        for (int x = 0; x < spectrum.cols; ++x) {
+            float magnitude = sqrt(p[2 * x] * p[2 * x] + p[2 * x + 1] * p[2 * x + 1]) + 1e-3f;
+            p[2 * x] /= magnitude;
+            p[2 * x + 1] /= magnitude;
+        }
+    }
+
+    // ÿȡͼߵ壬ֵͼ׼ı
+    for (int orientation = 0; orientation < 4; ++orientation) {
+        Mat product;
+        Mat correlation;
+        mulSpectrums(key.syncSpectrum[orientation], spectrum, product, 0, true);
+        dft(product, correlation, DFT_INVERSE | DFT_REAL_OUTPUT | DFT_SCALE);
+        double sum = 0;
+        double sumSquares = 0;
+        float best[2] = { -FLT_MAX, -FLT_MAX };
+        int bestIndex[2] = { 0, 0 };
+        for (int y = 0; y < correlation.rows; ++y) {
+            const float* row = correlation.ptr<float>(y);
+            for (int x = 0; x < correlation.cols; ++x) {
+                sum += row[x];
+                sumSquares += static_cast<double>(row[x]) * row[x];
+                if (row[x] > best[0]) {
+                    best[1] = best[0];
+                    bestIndex[1] = bestIndex[0];
+                    best[0] = row[x];
+                    bestIndex[0] = y * correlation.cols + x;
+                }
+                else if (row[x] > best[1]) {
+                    best[1] = row[x];
+                    bestIndex[1] = y * correlation.cols + x;
+                }
+            }
+        }
+        double count = static_cast<double>(correlation.total());
+        double mean = sum / count;
+        double deviation = sqrt(max(sumSquares / count - mean * mean, 1e-12));
+        for (int i = 0; i < 2; ++i) {
+            WatermarkAlignment alignment;
+            alignment.flipX = (orientation & 1) != 0;
+            alignment.flipY = (orientation & 2) != 0;
+            alignment.dx = bestIndex[i] % WM_TILE_PIXELS;
+            alignment.dy = bestIndex[i] / WM_TILE_PIXELS;
+            alignment.score = static_cast<float>((best[i] - mean) / deviation);
+            candidates.push_back(alignment);
+        }
+    }
+    sort(candidates.begin(), candidates.end(), [](const WatermarkAlignment& a, const WatermarkAlignment& b) { return a.score > b.score; });
+}
+
+// ļζӦϵ۵ͼϼغλֵ֮͡ԵģͼͬһƬλõ
+// ͼֵ֮ͣ۵ͼиλõĿͼֵֻͼԵĿ飩
+//  bitSum ķ extractWatermarkSoft Ӳоһ£ֻһƬ
+void foldedWatermarkSums(const Mat& folded, const WatermarkKey& key, const WatermarkAlignment& alignment, double bitSum[WM_PAYLOAD_BITS]) {
+    fill(bitSum, bitSum + WM_PAYLOAD_BITS, 0.0);
+    vector<float> patterns;
+    vector<int> slots;
+    orientWatermarkPatterns(key, alignment.flipX, alignment.flipY, patterns, slots);
+    for (int oriented = 0; oriented < WM_TILE_SLOTS; ++oriented) {
+        int bit = key.bitOfSlot[slots[oriented]];
+        if (bit < 0) {
+            continue;
+        }
+        // Ƭе (tx, ty) Ӧ۵ͼ ((tx - dx) mod WM_TILE_PIXELS, (ty - dy) mod WM_TILE_PIXELS)
+        int x0 = (oriented % WM_TILE_BLOCKS) * WM_BLOCK - alignment.dx + WM_TILE_PIXELS;
+        int y0 = (oriented / WM_TILE_BLOCKS) * WM_BLOCK - alignment.dy + WM_TILE_PIXELS;
+        const float* pattern = &patterns[oriented * WM_BLOCK_PIXELS];
+        float corr = 0;
+        for (int y = 0; y < WM_BLOCK; ++y) {
+            const float* row = folded.ptr<float>((y0 + y) % WM_TILE_PIXELS);
+            for (int x = 0; x < WM_BLOCK; ++x) {
+                corr += row[(x0 + x) % WM_TILE_PIXELS] * pattern[y * WM_BLOCK + x];
+            }
+        }
+        bitSum[bit] += corr;
+    }
+}
+
+// ļζӦϵغλоֵӦͼֵۼӵغλϣ
+// ÿһλֵ֮ͳƽ͵ƽΪһֵ soft[b]ˮӡʱӱ׼ֲ̬
+// confidence Ϊλһֵֵľֵ
+bool extractWatermarkSoft(const Mat& src, const WatermarkKey& key, const WatermarkAlignment& alignment, double soft[WM_PAYLOAD_BITS], float& confidence) {
+    fill(soft, soft + WM_PAYLOAD_BITS, 0.0);
+    confidence = 0;
+    if (src.empty() || src.depth() != CV_8U || src.channels() > 4) {
+        return false;
+    }
+    // һ㣬ʹ (x + dx)  (y + dy) ǿС
+    int xStart = (WM_BLOCK - alignment.dx % WM_BLOCK) % WM_BLOCK;
+    int yStart = (WM_BLOCK - alignment.dy % WM_BLOCK) % WM_BLOCK;
+    int blockRows = (src.rows - yStart) / WM_BLOCK;
+    int blockCols = (src.cols - xStart) / WM_BLOCK;
+    if (blockRows <= 0 || blockCols <= 0) {
+        return false;
+    }
+    vector<float> patterns;
+    vector<int> slots;
+    orientWatermarkPatterns(key, alignment.flipX, alignment.flipY, patterns, slots);
+
+    int cn = src.channels();
+    // ÿеĲֺ͵ţ˳鲢߳޹
+    vector<double> sums(static_cast<size_t>(blockRows) * WM_PAYLOAD_BITS * 2, 0.0);
+    parallel_for_(Range(0, blockRows), [&](const Range& range) {
+        float luma[WM_BLOCK][WM_TILE_PIXELS];
+        for (int by = range.start; by < range.end; ++by) {
+            double* rowSums = &sums[static_cast<size_t>(by) * WM_PAYLOAD_BITS * 2];
+            int y0 = yStart + by * WM_BLOCK;
+            int tileY = ((y0 + alignment.dy) % WM_TILE_PIXELS) / WM_BLOCK;
+            for (int x0 = xStart; x0 < xStart + blockCols * WM_BLOCK; x0 += WM_TILE_PIXELS) {
+                int width = min(WM_TILE_PIXELS, xStart + blockCols * WM_BLOCK - x0);
+                for (int y = 0; y < WM_BLOCK; ++y) {
+                    lumaRow(src.ptr<uchar>(y0 + y) + x0 * cn, cn, width, luma[y]);
+                }
+                for (int lx = 0; lx < width; lx += WM_BLOCK) {
+                    int tileX = ((x0 + lx + alignment.dx) % WM_TILE_PIXELS) / WM_BLOCK;
+                    int oriented = tileY * WM_TILE_BLOCKS + tileX;
+                    int bit = key.bitOfSlot[slots[oriented]];
+                    if (bit < 0) {
+                        continue;
+                    }
+                    const float* pattern = &patterns[oriented * WM_BLOCK_PIXELS];
+                    float corr = 0;
+                    for (int y = 0; y < WM_BLOCK; ++y) {
+                        for (int x = 0; x < WM_BLOCK; ++x) {
+                            corr += luma[y][lx + x] * pattern[y * WM_BLOCK + x];
+                        }
+                    }
+                    rowSums[bit * 2] += corr;
+                    rowSums[bit * 2 + 1] += static_cast<double>(corr) * corr;
+                }
+            }
+        }
+    });
+
+    double bitSum[WM_PAYLOAD_BITS] = { 0 };
+    double bitEnergy[WM_PAYLOAD_BITS] = { 0 };
+    for (int by = 0; by < blockRows; ++by) {
+        for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+            bitSum[b] += sums[(static_cast<size_t>(by) * WM_PAYLOAD_BITS + b) * 2];
+            bitEnergy[b] += sums[(static_cast<size_t>(by) * WM_PAYLOAD_BITS + b) * 2 + 1];
+        }
+    }
+    double total = 0;
+    for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+        if (bitEnergy[b] > 0) {
+            soft[b] = bitSum[b] / sqrt(bitEnergy[b]);
+        }
+        total += fabs(soft[b]);
+    }
+    confidence = static_cast<float>(total / WM_PAYLOAD_BITS);
+    return true;
+}
+
+// оֵӲоBCHȡλʱ false
+bool decodeWatermarkPayload(const double soft[WM_PAYLOAD_BITS], vector<uint8_t>& data) {
+    uint8_t codeword[WM_PAYLOAD_BITS];
+    for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+        codeword[b] = soft[b] > 0 ? 1 : 0;
+    }
+    bool valid = bchDecode(codeword);
+    data.assign(codeword, codeword + WM_DATA_BITS);
+    return valid;
+}
+
+// ļζӦϵȡˮӡͼλʱֵҲܴܺ󵫸λǴģ
+// ֻ confidence  WM_DETECT_THRESHOLD BCHɹʱΪ⵽ˮӡ
+bool extractBlindWatermarkAt(const Mat& src, const WatermarkKey& key, const WatermarkAlignment& alignment, vector<uint8_t>& data, float& confidence) {
+    double soft[WM_PAYLOAD_BITS];
+    bool extracted = extractWatermarkSoft(src, key, alignment, soft, confidence);
+    bool valid = decodeWatermarkPayload(soft, data);
+    return extracted && confidence > WM_DETECT_THRESHOLD && valid;
+}
+
+// äȡˮӡͬ۵ͼϰطӸߵ͸ WM_SYNC_CANDIDATES λô֣
+// ȡһӲоͨBCHλãʱȡطߵλãֻѡеһλɨͼ
+bool extractBlindWatermark(const Mat& src, const WatermarkKey& key, vector<uint8_t>& data, float& confidence) {
+    data.assign(WM_DATA_BITS, 0);
+    confidence = 0;
+    Mat folded;
+    if (!foldWatermarkLuma(src, folded)) {
+        return false;
+    }
+    vector<WatermarkAlignment> candidates;
+    findFoldedAlignment(folded, key, candidates);
+    size_t chosen = 0;
+    vector<uint8_t> attempt;
+    for (size_t i = 0; i < candidates.size() && i < WM_SYNC_CANDIDATES; ++i) {
+        double bitSum[WM_PAYLOAD_BITS];
+        foldedWatermarkSums(folded, key, candidates[i], bitSum);
+        if (decodeWatermarkPayload(bitSum, attempt)) {
+            chosen = i;
+            break;
+        }
+    }
+    return extractBlindWatermarkAt(src, key, candidates[chosen], data, confidence);
+}
+
+// غɵԿSM4ԿԿֻչһΣHMAC-SM3 ״̬ҲԤãװ֤ÿʶֻ
+// һSM4ܺSM3ѹ
+struct PayloadKey {
+    vector<uint32_t> roundKeys;
+    hmac_sm3_key macKey;
+};
+
+// ԿԿ֤ԿSM3(ǩ || Կ) ǰ16ֽSM416ֽHMAC
+void initPayloadKey(PayloadKey& key, uint64_t secret) {
+    const char label[] = "watermark-payload";
+    vector<uint8_t> material(label, label + sizeof(label) - 1);
+    for (int i = 0; i < 8; ++i) {
+        material.push_back(static_cast<uint8_t>(secret >> (8 * i)));
+    }
+    vector<uint8_t> digest;
+    sm3_hash(material.data(), material.size(), digest);
+    key.roundKeys = key_expansion(digest.data());
+    hmac_sm3_init(key.macKey, digest.data() + SM4_BLOCK_SIZE, SM3_DIGEST_BYTES - SM4_BLOCK_SIZE);
+    fill(digest.begin(), digest.end(), 0);
+}
+
+// ñǩʼɼܱʶԿϳɳʼ죬Ҫ⴫
+void payloadKeystream(const PayloadKey& key, const uint8_t tag[WM_TAG_BITS / 8], uint8_t keystream[SM4_BLOCK_SIZE]) {
+    uint8_t block[SM4_BLOCK_SIZE] = { 0 };
+    copy(tag, tag + WM_TAG_BITS / 8, block);
+    sm4_crypt_block(block, key.roundKeys.data(), false, keystream);
+}
+
+// ѿͻʶװΪ WM_DATA_BITS λغɣǩΪ HMAC-SM3(ʶ) ǰ32λ
+// ʶԱǩΪSM4ܡûԿ޷α֤ͨغɣҲʶ
+vector<uint8_t> sealIdentifier(uint64_t id, const PayloadKey& key) {
+    uint8_t idBytes[WM_ID_BITS / 8];
+    for (int i = 0; i < WM_ID_BITS / 8; ++i) {
+        idBytes[i] = static_cast<uint8_t>(id >> (WM_ID_BITS - 8 - 8 * i));
+    }
+    uint8_t mac[SM3_DIGEST_BYTES];
+    hmac_sm3(key.macKey, idBytes, sizeof(idBytes), mac);
+    uint8_t keystream[SM4_BLOCK_SIZE];
+    payloadKeystream(key, mac, keystream);
+
+    vector<uint8_t> payload(WM_DATA_BITS);
+    for (int i = 0; i < WM_DATA_BITS / 8; ++i) {
+        uint8_t byte = i < WM_ID_BITS / 8 ? idBytes[i] ^ keystream[i] : mac[i - WM_ID_BITS / 8];
+        for (int j = 0; j < 8; ++j) {
+            payload[i * 8 + j] = (byte >> (7 - j)) & 1;
+        }
+    }
+    return payload;
+}
+
+// غеıʶ֤ǩǩʱ false
+bool openIdentifier(const vector<uint8_t>& payload, const PayloadKey& key, uint64_t& id) {
+    id = 0;
+    if (payload.size() != WM_DATA_BITS) {
+        return false;
+    }
+    uint8_t bytes[WM_DATA_BITS / 8] = { 0 };
+    for (int i = 0; i < WM_DATA_BITS; ++i) {
+        bytes[i / 8] = static_cast<uint8_t>((bytes[i / 8] << 1) | (payload[i] & 1));
+    }
+    const uint8_t* tag = bytes + WM_ID_BITS / 8;
+    uint8_t keystream[SM4_BLOCK_SIZE];
+    payloadKeystream(key, tag, keystream);
+    uint8_t idBytes[WM_ID_BITS / 8];
+    for (int i = 0; i < WM_ID_BITS / 8; ++i) {
+        idBytes[i] = bytes[i] ^ keystream[i];
+        id = (id << 8) | idBytes[i];
+    }
+    uint8_t mac[SM3_DIGEST_BYTES];
+    hmac_sm3(key.macKey, idBytes, sizeof(idBytes), mac);
+    // Ƚʱǰ˳ʱǩ޹
+    uint8_t difference = 0;
+    for (int i = 0; i < WM_TAG_BITS / 8; ++i) {
+        difference |= mac[i] ^ tag[i];
+    }
+    return difference == 0;
+}
+
+// ֤ȡغɡ̴߳һΣͬһԤõԿ״̬
+// ids  valid  payloads һһӦ֤ͨĸ
+size_t verifySealedPayloads(const vector<vector<uint8_t>>& payloads, const PayloadKey& key, vector<uint64_t>& ids, vector<uint8_t>& valid,
+    unsigned threadCount) {
+    ids.assign(payloads.size(), 0);
+    valid.assign(payloads.size(), 0);
+    // ÿغֻ輸΢룬ʱֵ߳
+    size_t perThread = 1024;
+    threadCount = static_cast<unsigned>(max<size_t>(1, min<size_t>(max(threadCount, 1u), (payloads.size() + perThread - 1) / perThread)));
+    auto verifyRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            valid[i] = openIdentifier(payloads[i], key, ids[i]) ? 1 : 0;
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        workers.emplace_back(verifyRange, payloads.size() * t / threadCount, payloads.size() * (t + 1) / threadCount);
+    }
+    verifyRange(0, payloads.size() / threadCount);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return static_cast<size_t>(count(valid.begin(), valid.end(), 1));
+}
+
+int payloadBitErrors(const vector<uint8_t>& a, const vector<uint8_t>& b) {
+    int errors = 0;
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+        errors += a[i] != b[i];
+    }
+    return errors;
+}
+
+// нУΪʱ pop close ֮ pop ȡʣԪغ󷵻 false
+template <typename T>
+class BlockingQueue {
+public:
+    void push(T item) {
+        {
+            lock_guard<mutex> lock(mtx);
+            items.push_back(move(item));
+        }
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> lock(mtx);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(mtx);
+            closed = true;
+        }
+        notEmpty.notify_all();
+    }
+
+private:
+    mutex mtx;
+    condition_variable notEmpty;
+    deque<T> items;
+    bool closed = false;
+};
+
+// еһۡ۵̶   ȡ  /Ƕ/  д   ֮ѭ
+// ȡ߳òвʱӶ;ͼѹҲظʹá
+struct BatchJob {
+    string path;
+    string outputPath;
+    vector<uchar> input;
+    vector<uchar> output;
+    bool ok = false;
+};
+
+struct BatchStats {
+    size_t images = 0;
+    size_t failed = 0;
+    double megapixels = 0;
+};
+
+bool readFileBytes(const string& path, vector<uchar>& bytes) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) {
+        return false;
+    }
+    streamsize size = file.tellg();
+    file.seekg(0);
+    bytes.resize(static_cast<size_t>(size));
+    return size == 0 || static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), size));
+}
+
+bool writeFileBytes(const string& path, const vector<uchar>& bytes) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+string fileExtension(const string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) {
+        return "";
+    }
+    string ext = path.substr(dot);
+    transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return ext;
+}
+
+string fileName(const string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+// 淶Ϊ·ж·ǷָͬһļWindows ²ִСдͳһתΪСд
+// ·ڵԭ޷淶ʱԭ·
+string canonicalPath(const string& path) {
+#ifdef _WIN32
+    char buffer[_MAX_PATH];
+    if (_fullpath(buffer, path.c_str(), _MAX_PATH) == nullptr) {
+        return path;
+    }
+    string result = buffer;
+    transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return result;
+#else
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (resolved == nullptr) {
+        return path;
+    }
+    string result = resolved;
+    free(resolved);
+    return result;
+#endif
+}
+
+// Ϊÿȷ·ļظ·бвͬĿ¼µͬļͬһļгΣʱ
+// μ _1_2  ׺д̰߳Ⱥาǡһ·ĳļʱ false
+// Ŀ¼Ŀ¼д̻߳ڶȡ̶߳ԭͼ֮ǰ
+bool planBatchOutputs(const vector<string>& inputs, const string& outputDir, vector<string>& outputs) {
+    set<string> inputPaths;
+    for (const auto& path : inputs) {
+        inputPaths.insert(canonicalPath(path));
+    }
+    string directory = canonicalPath(outputDir);
+    set<string> used;
+    outputs.clear();
+    for (const auto& path : inputs) {
+        string name = fileName(path);
+        size_t dot = name.find_last_of('.');
+        string stem = dot == string::npos ? name : name.substr(0, dot);
+        string ext = dot == string::npos ? "" : name.substr(dot);
+        string candidate = name;
+        string key = canonicalPath(directory + "/" + candidate);
+        for (int suffix = 1; used.count(key) != 0; ++suffix) {
+            candidate = stem + "_" + to_string(suffix) + ext;
+            key = canonicalPath(directory + "/" + candidate);
+        }
+        if (inputPaths.count(key) != 0) {
+            return false;
+        }
+        used.insert(key);
+        outputs.push_back(outputDir + "/" + candidate);
+    }
+    return true;
+}
+
+// ֻʽӳͼļֱӶȡӳҳ棬м仺
+class MappedImageFile {
+public:
+    MappedImageFile() = default;
+    MappedImageFile(const MappedImageFile&) = delete;
+    MappedImageFile& operator=(const MappedImageFile&) = delete;
+
+    ~MappedImageFile() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mappedSize = static_cast<size_t>(size.QuadPart);
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            close();
+            return false;
+        }
+        base = static_cast<const uchar*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (base == nullptr) {
+            close();
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close();
+            return false;
+        }
+        mappedSize = static_cast<size_t>(st.st_size);
+        void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = static_cast<const uchar*>(addr);
+        // ͷβ˳ȡļmadvise Ľֵöٶλ־ֱֽ
+        madvise(addr, mappedSize, MADV_SEQUENTIAL);
+        madvise(addr, mappedSize, MADV_WILLNEED);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base != nullptr) {
+            UnmapViewOfFile(base);
+        }
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+            mappingHandle = nullptr;
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (base != nullptr) {
+            munmap(const_cast<uchar*>(base), mappedSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+        base = nullptr;
+        mappedSize = 0;
+    }
+
+    const uchar* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return mappedSize;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+    const uchar* base = nullptr;
+    size_t mappedSize = 0;
+};
+
+// ڴӿڶε֮临õͼ񻺳ÿ߳һݣͼߴ粻ʱٷ
+struct WatermarkBuffers {
+    Mat decoded;
+    Mat marked;
+};
+
+// չѡJPEG ʹýϸߵˮӡ
+vector<int> encodeParams(const string& ext) {
+    if (ext == ".jpg" || ext == ".jpeg") {
+        return { IMWRITE_JPEG_QUALITY, 95 };
+    }
+    return vector<int>();
+}
+
+// ÷ڴеıͼϴĻӳļֻ Mat ͷװ
+bool decodeImageBytes(const uchar* data, size_t size, Mat& image) {
+    if (data == nullptr || size == 0 || size > static_cast<size_t>(INT_MAX)) {
+        image.release();
+        return false;
+    }
+    Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<uchar*>(data));
+    imdecode(encoded, IMREAD_COLOR, &image);
+    return !image.empty();
+}
+
+// ڴеıͼǶäˮӡ ext ָĸʽ뵽 output̲ļϵͳ
+// мͼ buffers иãoutput Ҳڶε֮临
+bool watermarkImageBytes(const uchar* data, size_t size, const string& ext, const vector<uint8_t>& payload, const WatermarkKey& key,
+    WatermarkBuffers& buffers, vector<uchar>& output, float strength = WM_DEFAULT_STRENGTH) {
+    output.clear();
+    if (!decodeImageBytes(data, size, buffers.decoded) || !embedBlindWatermark(buffers.decoded, buffers.marked, payload, key, strength)) {
         return false;
     }
+    return imencode(ext, buffers.marked, output, encodeParams(ext));
 }
 
-// ³ԲԺ
-void robustnessTest(const Mat& original, const Mat& watermarked) {
-    std::vector<Mat> tests;
-    string testName;
-    Mat testImage;
-
-    // ת
-    testImage = watermarked.clone();
-    flip(testImage, testImage, 1); // ˮƽת
-    tests.push_back(testImage);
-    testName = "Flipped";
-    // ȡˮӡ
-    string extracted;
-    bool detected = extractWatermark(testImage, original, extracted);
-    cout << testName << " Image: " << extracted << endl;
-    imwrite(testName + "_image.jpg", testImage); // ͼ
-
-    // ƽƲ
-    testImage = watermarked.clone();
-    testImage = testImage(Rect(50, 50, testImage.cols - 100, testImage.rows - 100)).clone(); // ȡĲ
-    tests.push_back(testImage);
-    testName = "Translated";
-    detected = extractWatermark(testImage, original, extracted);
-    cout << testName << " Image: " << extracted << endl;
-    imwrite(testName + "_image.jpg", testImage); // ͼ
-
-    // ȡ
-    testImage = watermarked.clone();
-    testImage = testImage(Rect(100, 100, 200, 200)).clone(); // ȡһ
-    tests.push_back(testImage);
-    testName = "Cropped";
-    detected = extractWatermark(testImage, original, extracted);
-    cout << testName << " Image: " << extracted << endl;
-    imwrite(testName + "_image.jpg", testImage); // ͼ
-
-    // ԱȶȲ
-    testImage = watermarked.clone();
-    testImage.convertTo(testImage, -1, 1.5, 0); // ӶԱȶ
-    tests.push_back(testImage);
-    testName = "Contrast Adjusted";
-    detected = extractWatermark(testImage, original, extracted);
-    cout << testName << " Image: " << extracted << endl;
-    imwrite(testName + "_image.jpg", testImage); // ͼ
+// ڴеıͼäȡغ
+bool extractImageBytes(const uchar* data, size_t size, const WatermarkKey& key, WatermarkBuffers& buffers, vector<uint8_t>& payload, float& confidence) {
+    payload.assign(WM_DATA_BITS, 0);
+    confidence = 0;
+    return decodeImageBytes(data, size, buffers.decoded) && extractBlindWatermark(buffers.decoded, key, payload, confidence);
+}
+
+// ӳ䲢ͼļ imread
+bool readMappedImage(const string& path, Mat& image) {
+    MappedImageFile file;
+    if (!file.open(path)) {
+        image.release();
+        return false;
+    }
+    return decodeImageBytes(file.data(), file.size(), image);
+}
+
+// Ϊ .txt ļʱÿһͼ·ΪĿ¼ȡгʽͼļ
+vector<string> listBatchInputs(const string& input) {
+    vector<string> paths;
+    if (fileExtension(input) == ".txt") {
+        ifstream list(input);
+        string line;
+        while (getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                paths.push_back(line);
+            }
+        }
+        return paths;
+    }
+    const string extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp", ".ppm", ".pgm" };
+    vector<String> files;
+    glob(input, files, false);
+    for (const auto& file : files) {
+        if (find(begin(extensions), end(extensions), fileExtension(file)) != end(extensions)) {
+            paths.push_back(file);
+        }
+    }
+    return paths;
+}
+
+// Ƕäˮӡһȡ̡߳threadCount ̺߳һд߳ˮߣ
+// ȡдĴI/O͸߳ϵĽ롢Ƕ롢ͬʱСÿ̶߳һͼ
+//   Ƕ  룬Լ Matͼ֮䲻뿪̵߳Ļ档
+// ֮߳䰴ͼУ˹ر OpenCV ڲĲУ߳
+// outputs Ϊ planBatchOutputs  inputs һһӦ·
+BatchStats runBatch(const vector<string>& inputs, const vector<string>& outputs, const vector<uint8_t>& data, const WatermarkKey& key, unsigned threadCount) {
+    BatchStats stats;
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    int previousThreads = getNumThreads();
+    setNumThreads(1);
+
+    vector<BatchJob> jobs(threadCount * 2 + 2);
+    BlockingQueue<BatchJob*> freeJobs;
+    BlockingQueue<BatchJob*> readyJobs;
+    BlockingQueue<BatchJob*> doneJobs;
+    for (auto& job : jobs) {
+        freeJobs.push(&job);
+    }
+
+    thread reader([&]() {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            BatchJob* job = nullptr;
+            freeJobs.pop(job);
+            job->path = inputs[i];
+            job->outputPath = outputs[i];
+            job->ok = readFileBytes(job->path, job->input);
+            readyJobs.push(job);
+        }
+        readyJobs.close();
+    });
+
+    atomic<unsigned> activeWorkers(threadCount);
+    atomic<uint64_t> pixels(0);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            WatermarkBuffers buffers;
+            BatchJob* job = nullptr;
+            while (readyJobs.pop(job)) {
+                if (job->ok) {
+                    job->ok = watermarkImageBytes(job->input.data(), job->input.size(), fileExtension(job->path), data, key, buffers, job->output);
+                }
+                if (job->ok) {
+                    pixels += static_cast<uint64_t>(buffers.marked.total());
+                }
+                doneJobs.push(job);
+            }
+            if (--activeWorkers == 0) {
+                doneJobs.close();
+            }
+        });
+    }
+
+    BatchJob* job = nullptr;
+    while (doneJobs.pop(job)) {
+        if (job->ok) {
+            job->ok = writeFileBytes(job->outputPath, job->output);
+        }
+        if (!job->ok) {
+            cout << "ʧ: " << job->path << endl;
+            ++stats.failed;
+        }
+        ++stats.images;
+        freeJobs.push(job);
+    }
+
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    setNumThreads(previousThreads);
+    stats.megapixels = pixels / 1e6;
+    return stats;
+}
+
+// 飺дÿͼäȡغɣһ֤غɵıǩõÿͼӦĿͻʶ
+// δ⵽ˮӡͼ valid Ϊ0detected Ϊ⵽ˮӡͼֵΪǩ֤ͨͼ
+size_t runVerify(const vector<string>& inputs, const WatermarkKey& key, const PayloadKey& payloadKey, unsigned threadCount,
+    vector<uint64_t>& ids, vector<uint8_t>& valid, size_t& detected) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    int previousThreads = getNumThreads();
+    setNumThreads(1);
+    vector<vector<uint8_t>> payloads(inputs.size());
+    vector<uint8_t> found(inputs.size(), 0);
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            WatermarkBuffers buffers;
+            MappedImageFile file;
+            for (size_t i = next++; i < inputs.size(); i = next++) {
+                float confidence = 0;
+                found[i] = file.open(inputs[i]) && extractImageBytes(file.data(), file.size(), key, buffers, payloads[i], confidence) ? 1 : 0;
+                file.close();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    setNumThreads(previousThreads);
+
+    verifySealedPayloads(payloads, payloadKey, ids, valid, threadCount);
+    detected = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        detected += found[i];
+        valid[i] = valid[i] && found[i];
+    }
+    return static_cast<size_t>(count(valid.begin(), valid.end(), 1));
+}
+
+// ˮߣһȡ̰߳˳ۣthreadCount ̲߳д߳Żȡ˳д
+// ۵̶Ϊ threadCount * 2 + 2   ȡ    д   ֮ѭ;
+// е Mat ȻҲظʹáread  false ʾJob Ҫ index Աд
+template <typename Job>
+size_t runOrderedPipeline(unsigned threadCount, const function<bool(Job&)>& read, const function<void(Job&)>& process, const function<void(Job&)>& write) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    vector<Job> jobs(threadCount * 2 + 2);
+    BlockingQueue<Job*> freeJobs;
+    BlockingQueue<Job*> readyJobs;
+    BlockingQueue<Job*> doneJobs;
+    for (auto& job : jobs) {
+        freeJobs.push(&job);
+    }
+
+    thread reader([&]() {
+        for (size_t index = 0;; ++index) {
+            Job* job = nullptr;
+            freeJobs.pop(job);
+            job->index = index;
+            if (!read(*job)) {
+                break;
+            }
+            readyJobs.push(job);
+        }
+        readyJobs.close();
+    });
+
+    atomic<unsigned> activeWorkers(threadCount);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            Job* job = nullptr;
+            while (readyJobs.pop(job)) {
+                process(*job);
+                doneJobs.push(job);
+            }
+            if (--activeWorkers == 0) {
+                doneJobs.close();
+            }
+        });
+    }
+
+    // ȡ̰߳˳ռۣһҪдһڴУŻþ
+    size_t written = 0;
+    vector<Job*> pending;
+    Job* job = nullptr;
+    while (doneJobs.pop(job)) {
+        pending.push_back(job);
+        for (bool advanced = true; advanced;) {
+            advanced = false;
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (pending[i]->index == written) {
+                    Job* next = pending[i];
+                    pending.erase(pending.begin() + i);
+                    write(*next);
+                    ++written;
+                    freeJobs.push(next);
+                    advanced = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return written;
+}
+
+// һ鼸α任ͬͼƵĸ֡ͼĸڣȡäˮӡforEachImage λصÿͼ񲢷ͼᱻΡ
+// һͼ۵ͬһ۵ͼһͬͼź̫޷ͬʱϲͬȻԡ
+// ڶڸѡӦϵ¼ÿͼλоֵۼӺо൱ڰŶȼȨͶƱ
+// ޷ʱϲԿȷȱʧͼֻǼ˲ͶƱ
+// used ΪͶƱͼdecoded Ϊɳɹͼ
+bool voteWatermarkPayload(const WatermarkKey& key, const function<size_t(const function<void(const Mat&)>&)>& forEachImage,
+    vector<uint8_t>& data, float& confidence, size_t& used, size_t& decoded) {
+    data.assign(WM_DATA_BITS, 0);
+    confidence = 0;
+    used = 0;
+    decoded = 0;
+    Mat folded;
+    forEachImage([&](const Mat& image) { foldWatermarkLuma(image, folded); });
+    if (folded.empty()) {
+        return false;
+    }
+    vector<WatermarkAlignment> candidates;
+    findFoldedAlignment(folded, key, candidates);
+    candidates.resize(min(candidates.size(), static_cast<size_t>(WM_SYNC_CANDIDATES)));
+
+    vector<vector<double>> combined(candidates.size(), vector<double>(WM_PAYLOAD_BITS, 0.0));
+    vector<size_t> decodedBy(candidates.size(), 0);
+    vector<uint8_t> imageData;
+    used = forEachImage([&](const Mat& image) {
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            double soft[WM_PAYLOAD_BITS];
+            float imageConfidence = 0;
+            if (!extractWatermarkSoft(image, key, candidates[c], soft, imageConfidence)) {
+                continue;
+            }
+            if (imageConfidence > WM_DETECT_THRESHOLD && decodeWatermarkPayload(soft, imageData)) {
+                ++decodedBy[c];
+            }
+            for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+                combined[c][b] += soft[b];
+            }
+        }
+    });
+    if (used == 0) {
+        return false;
+    }
+
+    // ͼĹһֵ֮ͳͼƽˮӡʱԷӱ׼ֲ̬
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        double total = 0;
+        for (int b = 0; b < WM_PAYLOAD_BITS; ++b) {
+            combined[c][b] /= sqrt(static_cast<double>(used));
+            total += fabs(combined[c][b]);
+        }
+        float candidateConfidence = static_cast<float>(total / WM_PAYLOAD_BITS);
+        vector<uint8_t> candidateData;
+        bool valid = decodeWatermarkPayload(combined[c].data(), candidateData);
+        if (c == 0 || (valid && candidateConfidence > WM_DETECT_THRESHOLD)) {
+            data = candidateData;
+            confidence = candidateConfidence;
+            decoded = decodedBy[c];
+        }
+        if (valid && candidateConfidence > WM_DETECT_THRESHOLD) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Ƶеһ֡Ϊˮߵ
+struct VideoFrameJob {
+    size_t index = 0;
+    Mat frame;
+    Mat marked;
+    bool ok = false;
+};
+
+// Ƶÿһ֡Ƕͬäˮӡһ֡غɣ֡ᶪʧϢ
+// ȡ̰߳˳֡threadCount ̲߳Ƕ룬ԭ˳дء
+bool addVideoWatermark(const string& inputPath, const string& outputPath, const vector<uint8_t>& data, const WatermarkKey& key,
+    float strength, unsigned threadCount, size_t& frameCount) {
+    frameCount = 0;
+    VideoCapture capture(inputPath);
+    if (!capture.isOpened()) {
+        return false;
+    }
+    double fps = capture.get(CAP_PROP_FPS);
+    int fourcc = static_cast<int>(capture.get(CAP_PROP_FOURCC));
+    Size frameSize(static_cast<int>(capture.get(CAP_PROP_FRAME_WIDTH)), static_cast<int>(capture.get(CAP_PROP_FRAME_HEIGHT)));
+    VideoWriter writer(outputPath, fourcc != 0 ? fourcc : VideoWriter::fourcc('m', 'p', '4', 'v'), fps > 0 ? fps : 25.0, frameSize);
+    if (!writer.isOpened()) {
+        return false;
+    }
+    int previousThreads = getNumThreads();
+    setNumThreads(1);
+    bool ok = true;
+    frameCount = runOrderedPipeline<VideoFrameJob>(threadCount,
+        [&](VideoFrameJob& job) { return capture.read(job.frame); },
+        [&](VideoFrameJob& job) { job.ok = embedBlindWatermark(job.frame, job.marked, data, key, strength); },
+        [&](VideoFrameJob& job) {
+            ok = ok && job.ok;
+            writer.write(job.ok ? job.marked : job.frame);
+        });
+    setNumThreads(previousThreads);
+    return ok && frameCount > 0;
+}
+
+// Ƶȡäˮӡÿ frameStep ֡ȡһֻ֡֡ grab 룩ȡ֡ͶƱ
+// framesUsed ΪͶƱ֡framesDecoded Ϊɳɹ֡
+bool extractVideoWatermark(const string& path, const WatermarkKey& key, vector<uint8_t>& data, float& confidence,
+    size_t& framesUsed, size_t& framesDecoded, int frameStep = 1) {
+    frameStep = max(frameStep, 1);
+    auto forEachSampledFrame = [&](const function<void(const Mat&)>& visit) -> size_t {
+        VideoCapture capture(path);
+        if (!capture.isOpened()) {
+            return 0;
+        }
+        size_t sampled = 0;
+        Mat frame;
+        for (size_t index = 0;; ++index) {
+            if (index % frameStep != 0) {
+                if (!capture.grab()) {
+                    break;
+                }
+                continue;
+            }
+            if (!capture.read(frame)) {
+                break;
+            }
+            visit(frame);
+            ++sampled;
+        }
+        return sampled;
+    };
+    return voteWatermarkPayload(key, forEachSampledFrame, data, confidence, framesUsed, framesDecoded);
+}
+
+// ֿ鴦ͼʱʹö PGM/PPMP5/P6ÿ8λذţ԰˳д򰴴ȡ
+// Ҫͼ뵽ڴ档PPM ķ˳Ϊ RGBäˮӡԸɫͬ˳޹
+struct PnmInfo {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    streamoff dataOffset = 0;
+
+    size_t rowBytes() const {
+        return static_cast<size_t>(width) * channels;
+    }
+};
+
+bool readPnmHeader(istream& in, PnmInfo& info) {
+    char magic[2] = { 0, 0 };
+    if (!in.read(magic, 2) || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')) {
+        return false;
+    }
+    info.channels = magic[1] == '5' ? 1 : 3;
+    int fields[3] = { 0, 0, 0 };
+    for (int i = 0; i < 3; ++i) {
+        // հ׺ # ͷע
+        int c = in.get();
+        while (c == '#' || isspace(c)) {
+            if (c == '#') {
+                while (c != '\n' && c != EOF) {
+                    c = in.get();
+                }
+            }
+            c = in.get();
+        }
+        in.unget();
+        if (!(in >> fields[i]) || fields[i] <= 0) {
+            return false;
+        }
+    }
+    // ֵ֮ǡһհַΪ
+    if (fields[2] != 255 || !isspace(in.get())) {
+        return false;
+    }
+    info.width = fields[0];
+    info.height = fields[1];
+    info.dataOffset = in.tellg();
+    return true;
+}
+
+void writePnmHeader(ostream& out, const PnmInfo& info) {
+    out << (info.channels == 1 ? "P5" : "P6") << "\n" << info.width << " " << info.height << "\n255\n";
+}
+
+constexpr size_t WM_STRIP_BYTES = 8 << 20;     // ֿ鴦ʱÿĿС
+constexpr int WM_SAMPLE_WINDOW = 4 * WM_TILE_PIXELS;  // ʱÿڵı߳
+
+// ͼһˮƽΪˮߵ
+struct StripJob {
+    size_t index = 0;
+    Mat strip;
+    Mat marked;
+    bool ok = false;
+};
+
+// ֿǶäˮӡ߶ΪƬˮƽ롢Ƕ롢˳дƬ룬
+// ĽǶȫͬͬʱ;̶ֵڴֻȡͼȺ߳ͼ߶޹
+bool addTiledWatermark(const string& inputPath, const string& outputPath, const vector<uint8_t>& data, const WatermarkKey& key,
+    float strength, unsigned threadCount, size_t& stripCount) {
+    stripCount = 0;
+    ifstream in(inputPath, ios::binary);
+    PnmInfo info;
+    if (!in || !readPnmHeader(in, info)) {
+        return false;
+    }
+    ofstream out(outputPath, ios::binary | ios::trunc);
+    if (!out) {
+        return false;
+    }
+    writePnmHeader(out, info);
+    int stripRows = WM_TILE_PIXELS * static_cast<int>(max<size_t>(1, WM_STRIP_BYTES / (info.rowBytes() * WM_TILE_PIXELS)));
+    int previousThreads = getNumThreads();
+    setNumThreads(1);
+    bool ok = true;
+    int nextRow = 0;
+    stripCount = runOrderedPipeline<StripJob>(threadCount,
+        [&](StripJob& job) {
+            if (nextRow >= info.height) {
+                return false;
+            }
+            int rows = min(stripRows, info.height - nextRow);
+            nextRow += rows;
+            job.strip.create(rows, info.width, CV_8UC(info.channels));
+            job.ok = static_cast<bool>(in.read(reinterpret_cast<char*>(job.strip.data), static_cast<streamsize>(job.strip.total() * info.channels)));
+            return true;
+        },
+        [&](StripJob& job) { job.ok = job.ok && embedBlindWatermark(job.strip, job.marked, data, key, strength); },
+        [&](StripJob& job) {
+            ok = ok && job.ok;
+            const Mat& result = job.ok ? job.marked : job.strip;
+            out.write(reinterpret_cast<const char*>(result.data), static_cast<streamsize>(result.total() * info.channels));
+        });
+    setNumThreads(previousThreads);
+    return ok && static_cast<bool>(out) && nextRow == info.height;
+}
+
+// Դͼ⣺ͼϾȡ sampleCount ߳ WM_SAMPLE_WINDOW ĴڣֻȡڵأͶƱ
+// Ƭ룬ˮӡļζӦϵͬȡֻйأͼС޹
+bool extractTiledWatermark(const string& path, const WatermarkKey& key, int sampleCount, vector<uint8_t>& data, float& confidence,
+    size_t& samplesUsed, size_t& samplesDecoded) {
+    data.assign(WM_DATA_BITS, 0);
+    confidence = 0;
+    samplesUsed = 0;
+    samplesDecoded = 0;
+    ifstream in(path, ios::binary);
+    PnmInfo info;
+    if (!in || !readPnmHeader(in, info)) {
+        return false;
+    }
+    int windowWidth = min(WM_SAMPLE_WINDOW, info.width);
+    int windowHeight = min(WM_SAMPLE_WINDOW, info.height);
+    int grid = max(1, static_cast<int>(ceil(sqrt(static_cast<double>(max(sampleCount, 1))))));
+    vector<Mat> windows;
+    for (int gy = 0; gy < grid; ++gy) {
+        for (int gx = 0; gx < grid && static_cast<int>(windows.size()) < sampleCount; ++gx) {
+            // ڿȡķΧھȷֲ¶뵽Ƭ߽
+            int x = static_cast<int>(static_cast<int64_t>(info.width - windowWidth) * (2 * gx + 1) / (2 * grid));
+            int y = static_cast<int>(static_cast<int64_t>(info.height - windowHeight) * (2 * gy + 1) / (2 * grid));
+            x -= x % WM_TILE_PIXELS;
+            y -= y % WM_TILE_PIXELS;
+            Mat window(windowHeight, windowWidth, CV_8UC(info.channels));
+            for (int row = 0; row < windowHeight; ++row) {
+                in.seekg(info.dataOffset + static_cast<streamoff>((static_cast<size_t>(y) + row) * info.rowBytes() + static_cast<size_t>(x) * info.channels));
+                in.read(reinterpret_cast<char*>(window.ptr(row)), static_cast<streamsize>(windowWidth) * info.channels);
+            }
+            if (!in) {
+                return false;
+            }
+            windows.push_back(window);
+        }
+    }
+    auto forEachWindow = [&](const function<void(const Mat&)>& visit) -> size_t {
+        for (const auto& window : windows) {
+            visit(window);
+        }
+        return windows.size();
+    };
+    return voteWatermarkPayload(key, forEachWindow, data, confidence, samplesUsed, samplesDecoded);
+}
+
+// ³еһֹapply  src 任Ϊ dstgen üλõ
+struct WatermarkAttack {
+    string name;
+    function<void(const Mat& src, Mat& dst, mt19937& gen)> apply;
+};
+
+// ÿ ":1,2,..."ÿһֹ
+// nonejpeg:scale:űrotate:Ƕȡcrop:ı߳contrast:Աȶȱgamma:٤ֵnoise:˹׼blur:˹ģsigma
+bool parseAttackMatrix(const vector<string>& specs, vector<WatermarkAttack>& attacks) {
+    attacks.clear();
+    for (const auto& spec : specs) {
+        size_t colon = spec.find(':');
+        string type = spec.substr(0, colon);
+        if (type == "none") {
+            attacks.push_back({ "none", [](const Mat& src, Mat& dst, mt19937&) { src.copyTo(dst); } });
+            continue;
+        }
+        if (colon == string::npos) {
+            return false;
+        }
+        stringstream values(spec.substr(colon + 1));
+        string item;
+        while (getline(values, item, ',')) {
+            double value = atof(item.c_str());
+            string name = type + " " + item;
+            if (type == "jpeg") {
+                int quality = static_cast<int>(value);
+                attacks.push_back({ name, [quality](const Mat& src, Mat& dst, mt19937&) {
+                    vector<uchar> encoded;
+                    imencode(".jpg", src, encoded, { IMWRITE_JPEG_QUALITY, quality });
+                    dst = imdecode(encoded, IMREAD_UNCHANGED);
+                } });
+            }
+            else if (type == "scale") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    resize(src, dst, Size(), value, value, value < 1 ? INTER_AREA : INTER_CUBIC);
+                } });
+            }
+            else if (type == "rotate") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    Mat rotation = getRotationMatrix2D(Point2f(src.cols / 2.0f, src.rows / 2.0f), value, 1.0);
+                    warpAffine(src, dst, rotation, src.size(), INTER_LINEAR, BORDER_REFLECT);
+                } });
+            }
+            else if (type == "crop") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937& gen) {
+                    int width = max(1, static_cast<int>(src.cols * value));
+                    int height = max(1, static_cast<int>(src.rows * value));
+                    int x = static_cast<int>(gen() % (src.cols - width + 1));
+                    int y = static_cast<int>(gen() % (src.rows - height + 1));
+                    src(Rect(x, y, width, height)).copyTo(dst);
+                } });
+            }
+            else if (type == "contrast") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    src.convertTo(dst, -1, value, 128 * (1 - value));
+                } });
+            }
+            else if (type == "gamma") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    Mat lut(1, 256, CV_8UC1);
+                    for (int i = 0; i < 256; ++i) {
+                        lut.at<uchar>(0, i) = saturate_cast<uchar>(255.0 * pow(i / 255.0, value));
+                    }
+                    LUT(src, lut, dst);
+                } });
+            }
+            else if (type == "noise") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    Mat noise(src.size(), CV_32FC(src.channels()));
+                    randn(noise, 0, value);
+                    add(src, noise, dst, noArray(), src.type());
+                } });
+            }
+            else if (type == "blur") {
+                attacks.push_back({ name, [value](const Mat& src, Mat& dst, mt19937&) {
+                    int size = 2 * static_cast<int>(ceil(3 * value)) + 1;
+                    GaussianBlur(src, dst, Size(size, size), value);
+                } });
+            }
+            else {
+                return false;
+            }
+        }
+    }
+    return !attacks.empty();
+}
+
+// ϵSSIM884زȡSSIMƽֵ
+double computeSSIM(const Mat& a, const Mat& b) {
+    const double C1 = (0.01 * 255) * (0.01 * 255);
+    const double C2 = (0.03 * 255) * (0.03 * 255);
+    Mat lumaA(a.size(), CV_32FC1);
+    Mat lumaB(b.size(), CV_32FC1);
+    for (int y = 0; y < a.rows; ++y) {
+        lumaRow(a.ptr<uchar>(y), a.channels(), a.cols, lumaA.ptr<float>(y));
+        lumaRow(b.ptr<uchar>(y), b.channels(), b.cols, lumaB.ptr<float>(y));
+    }
+    double total = 0;
+    size_t windows = 0;
+    for (int y = 0; y + WM_BLOCK <= a.rows; y += WM_BLOCK / 2) {
+        for (int x = 0; x + WM_BLOCK <= a.cols; x += WM_BLOCK / 2) {
+            double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+            for (int i = 0; i < WM_BLOCK; ++i) {
+                const float* pa = lumaA.ptr<float>(y + i) + x;
+                const float* pb = lumaB.ptr<float>(y + i) + x;
+                for (int j = 0; j < WM_BLOCK; ++j) {
+                    sumA += pa[j];
+                    sumB += pb[j];
+                    sumAA += pa[j] * pa[j];
+                    sumBB += pb[j] * pb[j];
+                    sumAB += pa[j] * pb[j];
+                }
+            }
+            double meanA = sumA / WM_BLOCK_PIXELS;
+            double meanB = sumB / WM_BLOCK_PIXELS;
+            double varA = sumAA / WM_BLOCK_PIXELS - meanA * meanA;
+            double varB = sumBB / WM_BLOCK_PIXELS - meanB * meanB;
+            double cov = sumAB / WM_BLOCK_PIXELS - meanA * meanB;
+            total += (2 * meanA * meanB + C1) * (2 * cov + C2) / ((meanA * meanA + meanB * meanB + C1) * (varA + varB + C2));
+            ++windows;
+        }
+    }
+    return windows ? total / windows : 1.0;
+}
+
+// һͼһֹµĽˮӡͼĴλǷͼŶȺȡʱ
+struct AttackOutcome {
+    int bitErrors = 0;
+    bool detected = false;
+    bool falsePositive = false;
+    float markedScore = 0;
+    float cleanScore = 0;
+    double extractMs = 0;
+    double megapixels = 0;
+};
+
+struct ImageOutcome {
+    bool ok = false;
+    double psnr = 0;
+    double ssim = 0;
+    double embedMs = 0;
+    double megapixels = 0;
+    vector<AttackOutcome> attacks;
+};
+
+// ŶΪROCMann-Whitney U ͳ
+double detectionAUC(const vector<float>& positives, const vector<float>& negatives) {
+    if (positives.empty() || negatives.empty()) {
+        return 0;
+    }
+    double wins = 0;
+    for (float p : positives) {
+        for (float n : negatives) {
+            wins += p > n ? 1.0 : (p == n ? 0.5 : 0.0);
+        }
+    }
+    return wins / (static_cast<double>(positives.size()) * negatives.size());
+}
+
+// ϲ⣺ÿͼǶˮӡ󣬶Դˮӡͼԭͼֱʩÿֹȡ
+// ԭͼϵĽΪڼʺROC̰߳ͼУر OpenCV ڲĲС
+void runRobustnessBenchmark(const vector<string>& inputs, const vector<WatermarkAttack>& attacks, const WatermarkKey& key, const vector<uint8_t>& payload,
+    float strength, unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    int previousThreads = getNumThreads();
+    setNumThreads(1);
+    vector<ImageOutcome> outcomes(inputs.size());
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&]() {
+            Mat marked;
+            Mat attacked;
+            vector<uint8_t> extracted;
+            for (size_t i = next++; i < inputs.size(); i = next++) {
+                ImageOutcome& outcome = outcomes[i];
+                Mat original = imread(inputs[i]);
+                if (original.empty()) {
+                    continue;
+                }
+                outcome.megapixels = original.total() / 1e6;
+                auto start = chrono::steady_clock::now();
+                embedBlindWatermark(original, marked, payload, key, strength);
+                outcome.embedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                outcome.psnr = PSNR(original, marked);
+                outcome.ssim = computeSSIM(original, marked);
+                outcome.attacks.resize(attacks.size());
+                for (size_t a = 0; a < attacks.size(); ++a) {
+                    AttackOutcome& result = outcome.attacks[a];
+                    mt19937 gen(static_cast<uint32_t>(i * attacks.size() + a));
+                    attacks[a].apply(marked, attacked, gen);
+                    result.megapixels = attacked.total() / 1e6;
+                    start = chrono::steady_clock::now();
+                    bool found = extractBlindWatermark(attacked, key, extracted, result.markedScore);
+                    result.extractMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                    result.bitErrors = payloadBitErrors(extracted, payload);
+                    result.detected = found && result.bitErrors == 0;
+
+                    gen.seed(static_cast<uint32_t>(i * attacks.size() + a));
+                    attacks[a].apply(original, attacked, gen);
+                    result.falsePositive = extractBlindWatermark(attacked, key, extracted, result.cleanScore);
+                }
+                outcome.ok = true;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    setNumThreads(previousThreads);
+
+    size_t images = 0;
+    double psnr = 0, ssim = 0, embedMs = 0, embedMegapixels = 0;
+    for (const auto& outcome : outcomes) {
+        if (outcome.ok) {
+            ++images;
+            psnr += outcome.psnr;
+            ssim += outcome.ssim;
+            embedMs += outcome.embedMs;
+            embedMegapixels += outcome.megapixels;
+        }
+    }
+    if (images == 0) {
+        cout << "ûпõͼ" << endl;
+        return;
+    }
+    cout << "ͼ " << images << "Ƕǿ " << strength << "ƽPSNR " << psnr / images << " dBƽSSIM " << ssim / images
+        << "Ƕʱ " << embedMs / embedMegapixels << " ms/" << endl;
+    cout << "\t\t\t\tAUC\t1%ʱ\tȡʱ(ms/)" << endl;
+    for (size_t a = 0; a < attacks.size(); ++a) {
+        double bitErrors = 0, extractMs = 0, megapixels = 0;
+        size_t detected = 0, falsePositives = 0;
+        vector<float> positives, negatives;
+        for (const auto& outcome : outcomes) {
+            if (!outcome.ok) {
+                continue;
+            }
+            const AttackOutcome& result = outcome.attacks[a];
+            bitErrors += result.bitErrors;
+            detected += result.detected;
+            falsePositives += result.falsePositive;
+            extractMs += result.extractMs;
+            megapixels += result.megapixels;
+            positives.push_back(result.markedScore);
+            negatives.push_back(result.cleanScore);
+        }
+        // ԭͼ99%λΪֵͳƴˮӡͼиڸֵı
+        vector<float> sorted(negatives);
+        sort(sorted.begin(), sorted.end());
+        float threshold = sorted[min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))];
+        size_t above = count_if(positives.begin(), positives.end(), [threshold](float score) { return score > threshold; });
+        cout << attacks[a].name << "\t" << bitErrors / (images * WM_DATA_BITS) << "\t" << static_cast<double>(detected) / images << "\t"
+            << static_cast<double>(falsePositives) / images << "\t" << detectionAUC(positives, negatives) << "\t"
+            << static_cast<double>(above) / images << "\t" << extractMs / megapixels << endl;
+    }
+}
+
+// ӡغеĿͻʶǩ֤ͨʱע
+void printCustomer(const vector<uint8_t>& payload, const PayloadKey& payloadKey) {
+    uint64_t id = 0;
+    if (openIdentifier(payload, payloadKey, id)) {
+        cout << ", customer " << id << endl;
+    }
+    else {
+        cout << ", tag mismatch" << endl;
+    }
+}
+
+// ӡäˮӡȡǷ⵽ŶȡǶغȵĴλͽܳĿͻʶ
+void reportBlindExtraction(const string& testName, const Mat& image, const WatermarkKey& key, const PayloadKey& payloadKey, const vector<uint8_t>& payload) {
+    vector<uint8_t> extracted;
+    float confidence = 0;
+    bool detected = extractBlindWatermark(image, key, extracted, confidence);
+    cout << testName << " Image (blind): " << (detected ? "Watermark detected" : "No watermark detected")
+        << ", confidence " << confidence << ", bit errors " << payloadBitErrors(extracted, payload) << "/" << WM_DATA_BITS;
+    printCustomer(extracted, payloadKey);
+}
+
+// ³ԲԺÿͬʱڿɼˮӡͼäˮӡͼ
+void robustnessTest(const Mat& original, const Mat& watermarked, const Mat& blindMarked, const WatermarkKey& key, const PayloadKey& payloadKey,
+    const vector<uint8_t>& payload) {
+    vector<pair<string, function<Mat(const Mat&)>>> tests = {
+        // ת
+        { "Flipped", [](const Mat& image) { Mat out; flip(image, out, 1); return out; } }, // ˮƽת
+        // ƽƲ
+        { "Translated", [](const Mat& image) { return image(Rect(50, 50, image.cols - 100, image.rows - 100)).clone(); } }, // ȡĲ
+        // ȡ
+        { "Cropped", [](const Mat& image) { return image(Rect(100, 100, 200, 200)).clone(); } }, // ȡһ
+        // ԱȶȲ
+        { "Contrast Adjusted", [](const Mat& image) { Mat out; image.convertTo(out, -1, 1.5, 0); return out; } }, // ӶԱȶ
+    };
+
+    for (const auto& test : tests) {
+        Mat testImage = test.second(watermarked);
+        // ȡˮӡ
+        string extracted;
+        extractWatermark(testImage, original, extracted);
+        cout << test.first << " Image: " << extracted << endl;
+        imwrite(test.first + "_image.jpg", testImage); // ͼ
+
+        reportBlindExtraction(test.first, test.second(blindMarked), key, payloadKey, payload);
+    }
 }
 
 int main(int argc, char** argv) {
+    if (argc >= 4 && string(argv[1]) == "--batch") {
+        // ģʽΪĿ¼ÿһ· .txt ļäˮӡͼԭļдĿ¼ʱź׺
+        vector<string> inputs = listBatchInputs(argv[2]);
+        unsigned threadCount = argc > 4 ? static_cast<unsigned>(stoul(argv[4])) : thread::hardware_concurrency();
+        WatermarkKey key;
+        initWatermarkKey(key, WM_DEMO_SECRET);
+        PayloadKey payloadKey;
+        initPayloadKey(payloadKey, WM_DEMO_SECRET);
+        vector<string> outputs;
+        if (!planBatchOutputs(inputs, argv[3], outputs)) {
+            cout << "Ŀ¼ͼĿ¼ͬḲԭͼ: " << argv[3] << endl;
+            return -1;
+        }
+        auto start = chrono::steady_clock::now();
+        BatchStats stats = runBatch(inputs, outputs, sealIdentifier(WM_DEMO_CUSTOMER, payloadKey), key, threadCount);
+        chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+        cout << " " << stats.images << " ͼʧ " << stats.failed << " ʱ " << seconds.count() << " 룬"
+            << stats.images / seconds.count() << " /룬" << stats.megapixels / seconds.count() << " /" << endl;
+        return stats.failed == 0 ? 0 : -1;
+    }
+    if (argc >= 3 && string(argv[1]) == "--verify") {
+        // ģʽĿ¼·беÿͼȡäˮӡ֤ǩӦĿͻʶ
+        vector<string> inputs = listBatchInputs(argv[2]);
+        unsigned threadCount = argc > 3 ? static_cast<unsigned>(stoul(argv[3])) : thread::hardware_concurrency();
+        WatermarkKey key;
+        initWatermarkKey(key, WM_DEMO_SECRET);
+        PayloadKey payloadKey;
+        initPayloadKey(payloadKey, WM_DEMO_SECRET);
+        vector<uint64_t> ids;
+        vector<uint8_t> valid;
+        size_t detected = 0;
+        auto start = chrono::steady_clock::now();
+        size_t verified = runVerify(inputs, key, payloadKey, threadCount, ids, valid, detected);
+        chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (valid[i]) {
+                cout << inputs[i] << "\tcustomer " << ids[i] << endl;
+            }
+        }
+        cout << " " << inputs.size() << " ͼ񣬼⵽ˮӡ " << detected << " ǩ֤ͨ " << verified << " ʱ "
+            << seconds.count() << " " << endl;
+        return 0;
+    }
+    if (argc >= 3 && string(argv[1]) == "--bench") {
+        // ³⣺ΪĿ¼·бΪǶǿȡ߳͹󣬾ʡ
+        vector<string> inputs = listBatchInputs(argv[2]);
+        float strength = argc > 3 ? static_cast<float>(atof(argv[3])) : WM_DEFAULT_STRENGTH;
+        unsigned threadCount = argc > 4 ? static_cast<unsigned>(stoul(argv[4])) : thread::hardware_concurrency();
+        vector<string> specs(argv + min(argc, 5), argv + argc);
+        if (specs.empty()) {
+            specs = { "none", "jpeg:90,75,50,30", "scale:0.5,0.75,1.5", "rotate:1,5", "crop:0.75,0.5,0.25",
+                "contrast:0.7,1.5", "gamma:0.8,1.25", "noise:5,10,20", "blur:0.8,1.5" };
+        }
+        vector<WatermarkAttack> attacks;
+        if (!parseAttackMatrix(specs, attacks)) {
+            cout << "޷" << endl;
+            return -1;
+        }
+        WatermarkKey key;
+        initWatermarkKey(key, WM_DEMO_SECRET);
+        PayloadKey payloadKey;
+        initPayloadKey(payloadKey, WM_DEMO_SECRET);
+        runRobustnessBenchmark(inputs, attacks, key, sealIdentifier(WM_DEMO_CUSTOMER, payloadKey), strength, threadCount);
+        return 0;
+    }
+    if (argc >= 4 && string(argv[1]) == "--tiled") {
+        // ֿģʽ PGM/PPM ͼǶäˮӡٲͼ
+        unsigned threadCount = argc > 4 ? static_cast<unsigned>(stoul(argv[4])) : thread::hardware_concurrency();
+        WatermarkKey key;
+        initWatermarkKey(key, WM_DEMO_SECRET);
+        PayloadKey payloadKey;
+        initPayloadKey(payloadKey, WM_DEMO_SECRET);
+        size_t stripCount = 0;
+        auto start = chrono::steady_clock::now();
+        if (!addTiledWatermark(argv[2], argv[3], sealIdentifier(WM_DEMO_CUSTOMER, payloadKey), key, WM_DEFAULT_STRENGTH, threadCount, stripCount)) {
+            cout << "ֿǶʧܣΪÿ8λĶ PGM/PPM: " << argv[2] << endl;
+            return -1;
+        }
+        chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+        cout << "Ѵ " << stripCount << " ʱ " << seconds.count() << " 룬ˮӡͼѱΪ " << argv[3] << endl;
+
+        vector<uint8_t> extracted;
+        float confidence = 0;
+        size_t samplesUsed = 0;
+        size_t samplesDecoded = 0;
+        bool detected = extractTiledWatermark(argv[3], key, 16, extracted, confidence, samplesUsed, samplesDecoded);
+        cout << "Tiled (blind): " << (detected ? "Watermark detected" : "No watermark detected") << ", confidence " << confidence
+            << ", samples " << samplesDecoded << "/" << samplesUsed;
+        printCustomer(extracted, payloadKey);
+        return detected ? 0 : -1;
+    }
+    if (argc >= 4 && string(argv[1]) == "--video") {
+        // ƵģʽƵÿһ֡ǶäˮӡдƵٴƵȡ֤
+        unsigned threadCount = argc > 4 ? static_cast<unsigned>(stoul(argv[4])) : thread::hardware_concurrency();
+        WatermarkKey key;
+        initWatermarkKey(key, WM_DEMO_SECRET);
+        PayloadKey payloadKey;
+        initPayloadKey(payloadKey, WM_DEMO_SECRET);
+        vector<uint8_t> payload = sealIdentifier(WM_DEMO_CUSTOMER, payloadKey);
+        size_t frameCount = 0;
+        auto start = chrono::steady_clock::now();
+        if (!addVideoWatermark(argv[2], argv[3], payload, key, WM_DEFAULT_STRENGTH, threadCount, frameCount)) {
+            cout << "ƵˮӡǶʧ: " << argv[2] << endl;
+            return -1;
+        }
+        chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+        cout << "Ѵ " << frameCount << " ֡" << frameCount / seconds.count() << " ֡/룬ˮӡƵѱΪ " << argv[3] << endl;
+
+        vector<uint8_t> extracted;
+        float confidence = 0;
+        size_t framesUsed = 0;
+        size_t framesDecoded = 0;
+        bool detected = extractVideoWatermark(argv[3], key, extracted, confidence, framesUsed, framesDecoded);
+        cout << "Video (blind): " << (detected ? "Watermark detected" : "No watermark detected") << ", confidence " << confidence
+            << ", frames " << framesDecoded << "/" << framesUsed;
+        printCustomer(extracted, payloadKey);
+        return detected ? 0 : -1;
+    }
     if (argc != 2) {
         cout << "Usage: ./watermark <D:/vs_code/Project2/1005.jpg>" << endl;
+        cout << "       ./watermark --batch <ͼĿ¼·б.txt> <Ŀ¼> [߳]" << endl;
+        cout << "       ./watermark --verify <ͼĿ¼·б.txt> [߳]" << endl;
+        cout << "       ./watermark --tiled <.ppm> <.ppm> [߳]" << endl;
+        cout << "       ./watermark --video <Ƶ> <Ƶ> [߳]" << endl;
+        cout << "       ./watermark --bench <ͼĿ¼·б.txt> [Ƕǿ] [߳] [  jpeg:90,75 crop:0.5 ...]" << endl;
         return -1;
     }
 
     // вȡ·
     string imagePath = string(argv[1]);
 
-    Mat original = imread(imagePath);
-    if (original.empty()) {
+    Mat original;
+    if (!readMappedImage(imagePath, original)) {
         cout << "޷ͼ: " << imagePath << endl;
         return -1;
     }
@@ -116,8 +2076,21 @@ int main(int argc, char** argv) {
     imwrite("watermarked_image.jpg", watermarked);
     cout << "ˮӡͼѱΪ watermarked_image.jpg" << endl;
 
+    // äˮӡغΪSM4ܡHMAC-SM3֤ĿͻʶBCHǶ룬ȡʱֻҪԿ
+    WatermarkKey key;
+    initWatermarkKey(key, WM_DEMO_SECRET);
+    PayloadKey payloadKey;
+    initPayloadKey(payloadKey, WM_DEMO_SECRET);
+    vector<uint8_t> payload = sealIdentifier(WM_DEMO_CUSTOMER, payloadKey);
+    Mat blindMarked;
+    embedBlindWatermark(original, blindMarked, payload, key);
+    imwrite("blind_watermarked_image.jpg", blindMarked);
+    cout << "äˮӡͼѱΪ blind_watermarked_image.jpgPSNR = " << PSNR(original, blindMarked) << " dB" << endl;
+    reportBlindExtraction("Watermarked", blindMarked, key, payloadKey, payload);
+    reportBlindExtraction("Original", original, key, payloadKey, payload);
+
     // ³ԲԲͼ
-    robustnessTest(original, watermarked);
+    robustnessTest(original, watermarked, blindMarked, key, payloadKey, payload);
 
     return 0;
 }
\ No newline at end of file
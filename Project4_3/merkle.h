@@ -0,0 +1,1373 @@
+#ifndef MERKLE_H
+#define MERKLE_H
+
+#include <iostream>
+#include <vector>
+#include <sstream>
+#include <cstring>
+#include <string>
+#include <bitset>
+#include <random>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+constexpr int SM3_BLOCK_SIZE = 512;
+constexpr int SM3_DIGEST_SIZE = 256;
+constexpr int SM3_ROUNDS = 64;
+constexpr size_t SM3_BLOCK_BYTES = SM3_BLOCK_SIZE / 8;
+constexpr size_t SM3_DIGEST_BYTES = SM3_DIGEST_SIZE / 8;
+
+const uint32_t IV[8] = {
+    0x7380166F,
+    0x4914B2B9,
+    0x172442D7,
+    0xDA8A0600,
+    0xA96F30BC,
+    0x163138AA,
+    0xE38DEE4D,
+    0xB0FB0E4E
+};
+
+inline uint32_t left_rotate(uint32_t value, int shift) {
+    shift &= 31;
+    return shift == 0 ? value : (value << shift) | (value >> (32 - shift));
+}
+
+inline uint32_t P0(uint32_t x) {
+    return x ^ left_rotate(x, 9) ^ left_rotate(x, 17);
+}
+
+inline uint32_t P1(uint32_t x) {
+    return x ^ left_rotate(x, 15) ^ left_rotate(x, 23);
+}
+
+inline uint32_t FF(uint32_t x, uint32_t y, uint32_t z, int j) {
+    return j < 16 ? (x ^ y ^ z) : ((x & y) | (x & z) | (y & z));
+}
+
+inline uint32_t GG(uint32_t x, uint32_t y, uint32_t z, int j) {
+    return j < 16 ? (x ^ y ^ z) : ((x & y) | ((~x) & z));
+}
+
+inline uint32_t load_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+        (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) |
+        static_cast<uint32_t>(p[3]);
+}
+
+inline void store_be32(uint8_t* p, uint32_t v) {
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+inline uint64_t bswap64(uint64_t value) {
+    return ((value & 0x00000000000000FFULL) << 56) |
+        ((value & 0x000000000000FF00ULL) << 40) |
+        ((value & 0x0000000000FF0000ULL) << 24) |
+        ((value & 0x00000000FF000000ULL) << 8) |
+        ((value & 0x000000FF00000000ULL) >> 8) |
+        ((value & 0x0000FF0000000000ULL) >> 24) |
+        ((value & 0x00FF000000000000ULL) >> 40) |
+        ((value & 0xFF00000000000000ULL) >> 56);
+}
+
+inline void pad_message(const uint8_t* msg, size_t msg_len, vector<uint8_t>& padded, size_t& padded_len) {
+    size_t bit_length = msg_len * 8;
+    padded.reserve(msg_len + SM3_BLOCK_BYTES + 8);
+    padded.assign(msg, msg + msg_len);
+    padded.push_back(0x80);
+
+    size_t total_bits = (msg_len + 1) * 8;
+    size_t needed_bits = (448 - (total_bits % 512)) % 512;
+    size_t needed_bytes = (needed_bits + 7) / 8;
+
+    padded.insert(padded.end(), needed_bytes, 0x00);
+    msg_len = padded.size();
+
+    uint64_t bit_length_be = bswap64(static_cast<uint64_t>(bit_length));
+    padded.resize(msg_len + sizeof(uint64_t));
+    memcpy(padded.data() + msg_len, &bit_length_be, sizeof(uint64_t));
+    padded_len = padded.size();
+}
+
+struct SM3Schedule {
+    uint32_t W[68];
+    uint32_t W1[64];
+};
+
+struct SM3RoundConstants {
+    uint32_t T[SM3_ROUNDS];
+
+    SM3RoundConstants() {
+        for (int j = 0; j < SM3_ROUNDS; ++j) {
+            T[j] = left_rotate(j < 16 ? 0x79CC4519 : 0x7A879D8A, j);
+        }
+    }
+};
+
+const SM3RoundConstants SM3_T;
+
+inline void sm3_expand(const uint8_t block[SM3_BLOCK_BYTES], SM3Schedule& schedule) {
+    uint32_t* W = schedule.W;
+    for (int j = 0; j < 16; ++j) {
+        W[j] = load_be32(block + 4 * j);
+    }
+    for (int j = 16; j < 68; ++j) {
+        W[j] = P1(W[j - 16] ^ W[j - 9] ^ left_rotate(W[j - 3], 15)) ^ left_rotate(W[j - 13], 7) ^ W[j - 6];
+    }
+    for (int j = 0; j < SM3_ROUNDS; ++j) {
+        schedule.W1[j] = W[j] ^ W[j + 4];
+    }
+}
+
+inline void sm3_compress_expanded(uint32_t state[8], const SM3Schedule& schedule) {
+    uint32_t A = state[0];
+    uint32_t B = state[1];
+    uint32_t C = state[2];
+    uint32_t D = state[3];
+    uint32_t E = state[4];
+    uint32_t F = state[5];
+    uint32_t G = state[6];
+    uint32_t H = state[7];
+
+    for (int j = 0; j < SM3_ROUNDS; ++j) {
+        uint32_t A12 = left_rotate(A, 12);
+        uint32_t SS1 = left_rotate(A12 + E + SM3_T.T[j], 7);
+        uint32_t SS2 = SS1 ^ A12;
+        uint32_t TT1 = FF(A, B, C, j) + D + SS2 + schedule.W1[j];
+        uint32_t TT2 = GG(E, F, G, j) + H + SS1 + schedule.W[j];
+        D = C;
+        C = left_rotate(B, 9);
+        B = A;
+        A = TT1;
+        H = G;
+        G = left_rotate(F, 19);
+        F = E;
+        E = P0(TT2);
+    }
+
+    state[0] ^= A;
+    state[1] ^= B;
+    state[2] ^= C;
+    state[3] ^= D;
+    state[4] ^= E;
+    state[5] ^= F;
+    state[6] ^= G;
+    state[7] ^= H;
+}
+
+inline void sm3_compress(uint32_t state[8], const uint8_t block[SM3_BLOCK_BYTES]) {
+    SM3Schedule schedule;
+    sm3_expand(block, schedule);
+    sm3_compress_expanded(state, schedule);
+}
+
+inline void sm3_hash(const uint8_t* msg, size_t msg_len, vector<uint8_t>& hash_output) {
+    vector<uint8_t> padded;
+    size_t padded_len = 0;
+    pad_message(msg, msg_len, padded, padded_len);
+
+    uint32_t state[8];
+    memcpy(state, IV, sizeof(IV));
+
+    for (size_t i = 0; i + SM3_BLOCK_BYTES <= padded_len; i += SM3_BLOCK_BYTES) {
+        sm3_compress(state, padded.data() + i);
+    }
+
+    hash_output.resize(SM3_DIGEST_BYTES);
+    for (int i = 0; i < 8; ++i) {
+        store_be32(hash_output.data() + i * 4, state[i]);
+    }
+}
+
+// Ҷڲڵ㰴 RFC 6962 룺ҶӹϣΪ SM3(0x00 || Ϣ)ڲڵΪ SM3(0x01 ||  || )
+constexpr uint8_t MERKLE_LEAF_PREFIX = 0x00;
+constexpr uint8_t MERKLE_NODE_PREFIX = 0x01;
+
+inline void hash_leaf(const uint8_t* msg, size_t msg_len, uint8_t out[SM3_DIGEST_BYTES]) {
+    uint32_t state[8];
+    memcpy(state, IV, sizeof(IV));
+    uint64_t bit_length = (static_cast<uint64_t>(msg_len) + 1) * 8;
+
+    uint8_t block[SM3_BLOCK_BYTES];
+    block[0] = MERKLE_LEAF_PREFIX;
+    size_t used = 1;
+    while (msg_len > 0) {
+        size_t n = min(SM3_BLOCK_BYTES - used, msg_len);
+        memcpy(block + used, msg, n);
+        used += n;
+        msg += n;
+        msg_len -= n;
+        if (used == SM3_BLOCK_BYTES) {
+            sm3_compress(state, block);
+            used = 0;
+        }
+    }
+
+    block[used++] = 0x80;
+    if (used > SM3_BLOCK_BYTES - sizeof(uint64_t)) {
+        memset(block + used, 0, SM3_BLOCK_BYTES - used);
+        sm3_compress(state, block);
+        used = 0;
+    }
+    memset(block + used, 0, SM3_BLOCK_BYTES - sizeof(uint64_t) - used);
+    uint64_t bit_length_be = bswap64(bit_length);
+    memcpy(block + SM3_BLOCK_BYTES - sizeof(uint64_t), &bit_length_be, sizeof(uint64_t));
+    sm3_compress(state, block);
+
+    for (int i = 0; i < 8; ++i) {
+        store_be32(out + i * 4, state[i]);
+    }
+}
+
+// 65ֽڵڲڵ飬ڶֻֽڣӽڵϣһֽڣ仯
+// Ϊ̶ݡԤֽ256ȡֵµڶϢչ
+// ÿڵֻԵһһѹòõչɵڶѹ벻ǰ׺ʱͬ
+struct SM3NodeTailSchedules {
+    SM3Schedule schedule[256];
+
+    SM3NodeTailSchedules() {
+        uint8_t block[SM3_BLOCK_BYTES] = { 0 };
+        block[1] = 0x80;
+        uint64_t bit_length_be = bswap64(static_cast<uint64_t>(1 + 2 * SM3_DIGEST_BYTES) * 8);
+        memcpy(block + SM3_BLOCK_BYTES - sizeof(uint64_t), &bit_length_be, sizeof(uint64_t));
+        for (int last = 0; last < 256; ++last) {
+            block[0] = static_cast<uint8_t>(last);
+            sm3_expand(block, schedule[last]);
+        }
+    }
+};
+
+const SM3NodeTailSchedules SM3_NODE_TAIL;
+
+inline void hash_node_pair(const uint8_t left[SM3_DIGEST_BYTES], const uint8_t right[SM3_DIGEST_BYTES], uint8_t out[SM3_DIGEST_BYTES]) {
+    uint8_t block[SM3_BLOCK_BYTES];
+    block[0] = MERKLE_NODE_PREFIX;
+    memcpy(block + 1, left, SM3_DIGEST_BYTES);
+    memcpy(block + 1 + SM3_DIGEST_BYTES, right, SM3_DIGEST_BYTES - 1);
+    uint8_t last = right[SM3_DIGEST_BYTES - 1];
+
+    uint32_t state[8];
+    memcpy(state, IV, sizeof(IV));
+    sm3_compress(state, block);
+    sm3_compress_expanded(state, SM3_NODE_TAIL.schedule[last]);
+
+    for (int i = 0; i < 8; ++i) {
+        store_be32(out + i * 4, state[i]);
+    }
+}
+
+struct MerkleNode {
+    vector<uint8_t> hash;
+    shared_ptr<MerkleNode> left;
+    shared_ptr<MerkleNode> right;
+
+    MerkleNode(const vector<uint8_t>& h) : hash(h), left(nullptr), right(nullptr) {}
+};
+
+constexpr size_t MERKLE_MAX_DEPTH = 64;
+
+// ҶȡϸС䳤ȵ2ݣԵϲõһ£
+// ڴ밴洢ļϣͬ
+inline size_t merkleSplit(size_t l, size_t r) {
+    size_t count = r - l + 1;
+    size_t k = 1;
+    while (k * 2 < count) {
+        k *= 2;
+    }
+    return l + k - 1;
+}
+
+inline shared_ptr<MerkleNode> buildMerkleTree(const vector<vector<uint8_t>>& leafHashes, int start, int end) {
+    if (start == end) {
+        return make_shared<MerkleNode>(leafHashes[start]);
+    }
+    int mid = static_cast<int>(merkleSplit(start, end));
+    auto leftChild = buildMerkleTree(leafHashes, start, mid);
+    auto rightChild = buildMerkleTree(leafHashes, mid + 1, end);
+
+    vector<uint8_t> parentHash(SM3_DIGEST_BYTES);
+    hash_node_pair(leftChild->hash.data(), rightChild->hash.data(), parentHash.data());
+
+    auto parent = make_shared<MerkleNode>(parentHash);
+    parent->left = leftChild;
+    parent->right = rightChild;
+
+    return parent;
+}
+
+inline vector<vector<uint8_t>> getExistenceProof(shared_ptr<MerkleNode> root, int index, const vector<vector<uint8_t>>& leafHashes) {
+    vector<vector<uint8_t>> proof;
+    shared_ptr<MerkleNode> current = root;
+    int l = 0;
+    int r = leafHashes.size() - 1;
+    while (l != r) {
+        int mid = static_cast<int>(merkleSplit(l, r));
+        if (index <= mid) {
+            proof.push_back(current->right->hash);
+            current = current->left;
+            r = mid;
+        }
+        else {
+            proof.push_back(current->left->hash);
+            current = current->right;
+            l = mid + 1;
+        }
+    }
+    return proof;
+}
+
+// proof[0] Ǹڵһֵܽڵ㣬proof[depth - 1] Ҷӽڵֵܽڵ㡣
+// λ index  leafCount  buildMerkleTree Ļַʽԭ̲ڴ档
+inline bool verifyExistenceProofFast(const uint8_t rootHash[SM3_DIGEST_BYTES], const uint8_t leafHash[SM3_DIGEST_BYTES],
+    size_t index, size_t leafCount, const uint8_t proof[][SM3_DIGEST_BYTES], size_t depth) {
+    if (index >= leafCount || depth > MERKLE_MAX_DEPTH) {
+        return false;
+    }
+
+    uint64_t isRightChild = 0;
+    size_t level = 0;
+    size_t l = 0;
+    size_t r = leafCount - 1;
+    while (l != r) {
+        if (level == depth) {
+            return false;
+        }
+        size_t mid = merkleSplit(l, r);
+        if (index <= mid) {
+            r = mid;
+        }
+        else {
+            isRightChild |= 1ULL << level;
+            l = mid + 1;
+        }
+        ++level;
+    }
+    if (level != depth) {
+        return false;
+    }
+
+    uint8_t currentHash[SM3_DIGEST_BYTES];
+    memcpy(currentHash, leafHash, SM3_DIGEST_BYTES);
+    for (size_t i = depth; i-- > 0;) {
+        if ((isRightChild >> i) & 1) {
+            hash_node_pair(proof[i], currentHash, currentHash);
+        }
+        else {
+            hash_node_pair(currentHash, proof[i], currentHash);
+        }
+    }
+    return memcmp(currentHash, rootHash, SM3_DIGEST_BYTES) == 0;
+}
+
+inline bool verifyExistenceProof(const vector<uint8_t>& rootHash, const vector<uint8_t>& leafHash, size_t index, size_t leafCount, const vector<vector<uint8_t>>& proof) {
+    if (rootHash.size() != SM3_DIGEST_BYTES || leafHash.size() != SM3_DIGEST_BYTES || proof.size() > MERKLE_MAX_DEPTH) {
+        return false;
+    }
+    uint8_t siblings[MERKLE_MAX_DEPTH][SM3_DIGEST_BYTES];
+    for (size_t i = 0; i < proof.size(); ++i) {
+        if (proof[i].size() != SM3_DIGEST_BYTES) {
+            return false;
+        }
+        memcpy(siblings[i], proof[i].data(), SM3_DIGEST_BYTES);
+    }
+    return verifyExistenceProofFast(rootHash.data(), leafHash.data(), index, leafCount, siblings, proof.size());
+}
+
+inline bool areHashesEqual(const vector<uint8_t>& a, const vector<uint8_t>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+inline bool findTargetHash(shared_ptr<MerkleNode> node, const vector<uint8_t>& targetHash, vector<vector<uint8_t>>& proofPath, bool& found) {
+    if (!node) {
+        return false;
+    }
+
+    if (!node->left && !node->right) {
+        if (areHashesEqual(node->hash, targetHash)) {
+            found = true;
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+
+    bool leftExists = findTargetHash(node->left, targetHash, proofPath, found);
+    bool rightExists = findTargetHash(node->right, targetHash, proofPath, found);
+
+    if (found) {
+        if (leftExists) {
+            proofPath.push_back(node->right->hash);
+            return true;
+        }
+        if (rightExists) {
+            proofPath.push_back(node->left->hash);
+            return true;
+        }
+    }
+    else {
+        return false;
+    }
+
+    return false;
+}
+
+inline bool getNonExistenceProof(shared_ptr<MerkleNode> root, const vector<uint8_t>& targetHash, vector<vector<uint8_t>>& proofPath) {
+    bool found = false;
+    bool exists = findTargetHash(root, targetHash, proofPath, found);
+    if (exists) {
+        proofPath.clear();
+        return false;
+    }
+    else {
+        return true;
+    }
+}
+
+inline string bytesToHex(const vector<uint8_t>& bytes) {
+    ostringstream oss;
+    for (auto byte : bytes) {
+        oss << hex << setw(2) << setfill('0') << static_cast<int>(byte);
+    }
+    return oss.str();
+}
+
+// ϡMerkleҶλ256λSM3ժҪ Jellyfish/Diem ֻһֱɸüҶӴ棬
+// Ҷӷֿǰ׺ϣΪ SM3(0x00 ||  || ֵ)λ޹أĹϣΪȫ0
+// ڲڵĹϣΪ SM3(0x01 ||  || )״ֻɼϾҶԼΪ log2(n)
+// ˴洢Ϊ O(n)¡ɺֻ֤֤ O(log n) ιϣ
+constexpr int SMT_DEPTH = SM3_DIGEST_SIZE;
+
+struct SparseMerkleNode {
+    uint8_t hash[SM3_DIGEST_BYTES];
+    shared_ptr<SparseMerkleNode> left;
+    shared_ptr<SparseMerkleNode> right;
+    bool isLeaf = false;
+    uint8_t key[SM3_DIGEST_BYTES];
+    uint8_t value[SM3_DIGEST_BYTES];
+};
+
+// ѯ·Ӹ depth ֹڼڵҶӡһҶӣʱ otherKeyotherValue ΪҶӵݣ
+// bitmap ĵ d λΪ1ʾ d ֵܽڵ㲻ǿsiblings аӸҶ˳ֻЩǿֵܽڵ
+struct SparseMerkleProof {
+    int depth = 0;
+    uint8_t bitmap[SMT_DEPTH / 8];
+    vector<vector<uint8_t>> siblings;
+    bool hasOtherLeaf = false;
+    uint8_t otherKey[SM3_DIGEST_BYTES];
+    uint8_t otherValue[SM3_DIGEST_BYTES];
+};
+
+inline int smtKeyBit(const uint8_t key[SM3_DIGEST_BYTES], int depth) {
+    return (key[depth >> 3] >> (7 - (depth & 7))) & 1;
+}
+
+inline bool isZeroHash(const uint8_t hash[SM3_DIGEST_BYTES]) {
+    uint8_t acc = 0;
+    for (size_t i = 0; i < SM3_DIGEST_BYTES; ++i) {
+        acc |= hash[i];
+    }
+    return acc == 0;
+}
+
+const uint8_t SMT_EMPTY_HASH[SM3_DIGEST_BYTES] = { 0 };
+
+inline void smtHashLeaf(const uint8_t key[SM3_DIGEST_BYTES], const uint8_t value[SM3_DIGEST_BYTES], uint8_t out[SM3_DIGEST_BYTES]) {
+    uint8_t message[2 * SM3_DIGEST_BYTES];
+    memcpy(message, key, SM3_DIGEST_BYTES);
+    memcpy(message + SM3_DIGEST_BYTES, value, SM3_DIGEST_BYTES);
+    hash_leaf(message, sizeof(message), out);
+}
+
+inline void smtHashChildren(const shared_ptr<SparseMerkleNode>& left, const shared_ptr<SparseMerkleNode>& right, uint8_t out[SM3_DIGEST_BYTES]) {
+    hash_node_pair(left ? left->hash : SMT_EMPTY_HASH, right ? right->hash : SMT_EMPTY_HASH, out);
+}
+
+inline int smtFirstDifferentBit(const uint8_t a[SM3_DIGEST_BYTES], const uint8_t b[SM3_DIGEST_BYTES], int fromDepth) {
+    for (int depth = fromDepth; depth < SMT_DEPTH; ++depth) {
+        if (smtKeyBit(a, depth) != smtKeyBit(b, depth)) {
+            return depth;
+        }
+    }
+    return SMT_DEPTH;
+}
+
+class SparseMerkleTree {
+public:
+    // ֵΪȫ0ʾɾü
+    void update(const uint8_t key[SM3_DIGEST_BYTES], const uint8_t valueHash[SM3_DIGEST_BYTES]) {
+        root = update(root, 0, key, valueHash);
+    }
+
+    void remove(const uint8_t key[SM3_DIGEST_BYTES]) {
+        update(key, SMT_EMPTY_HASH);
+    }
+
+    bool get(const uint8_t key[SM3_DIGEST_BYTES], uint8_t valueHash[SM3_DIGEST_BYTES]) const {
+        shared_ptr<SparseMerkleNode> node = root;
+        for (int depth = 0; node; ++depth) {
+            if (node->isLeaf) {
+                if (memcmp(node->key, key, SM3_DIGEST_BYTES) != 0) {
+                    return false;
+                }
+                memcpy(valueHash, node->value, SM3_DIGEST_BYTES);
+                return true;
+            }
+            node = smtKeyBit(key, depth) ? node->right : node->left;
+        }
+        return false;
+    }
+
+    void rootHash(uint8_t out[SM3_DIGEST_BYTES]) const {
+        memcpy(out, root ? root->hash : SMT_EMPTY_HASH, SM3_DIGEST_BYTES);
+    }
+
+    // Բڵļ֤֤ͬʱȫ0ΪҶֵΪ֤
+    SparseMerkleProof getProof(const uint8_t key[SM3_DIGEST_BYTES]) const {
+        SparseMerkleProof proof;
+        memset(proof.bitmap, 0, sizeof(proof.bitmap));
+        shared_ptr<SparseMerkleNode> node = root;
+        while (node && !node->isLeaf) {
+            int bit = smtKeyBit(key, proof.depth);
+            const shared_ptr<SparseMerkleNode>& sibling = bit ? node->left : node->right;
+            if (sibling) {
+                proof.bitmap[proof.depth >> 3] |= 0x80 >> (proof.depth & 7);
+                proof.siblings.emplace_back(sibling->hash, sibling->hash + SM3_DIGEST_BYTES);
+            }
+            node = bit ? node->right : node->left;
+            ++proof.depth;
+        }
+        if (node && memcmp(node->key, key, SM3_DIGEST_BYTES) != 0) {
+            proof.hasOtherLeaf = true;
+            memcpy(proof.otherKey, node->key, SM3_DIGEST_BYTES);
+            memcpy(proof.otherValue, node->value, SM3_DIGEST_BYTES);
+        }
+        return proof;
+    }
+
+private:
+    static shared_ptr<SparseMerkleNode> makeLeaf(const uint8_t key[SM3_DIGEST_BYTES], const uint8_t value[SM3_DIGEST_BYTES]) {
+        auto leaf = make_shared<SparseMerkleNode>();
+        leaf->isLeaf = true;
+        memcpy(leaf->key, key, SM3_DIGEST_BYTES);
+        memcpy(leaf->value, value, SM3_DIGEST_BYTES);
+        smtHashLeaf(key, value, leaf->hash);
+        return leaf;
+    }
+
+    static shared_ptr<SparseMerkleNode> update(shared_ptr<SparseMerkleNode> node, int depth,
+        const uint8_t key[SM3_DIGEST_BYTES], const uint8_t value[SM3_DIGEST_BYTES]) {
+        bool erase = isZeroHash(value);
+        if (!node) {
+            return erase ? nullptr : makeLeaf(key, value);
+        }
+        if (node->isLeaf) {
+            if (memcmp(node->key, key, SM3_DIGEST_BYTES) == 0) {
+                return erase ? nullptr : makeLeaf(key, value);
+            }
+            return erase ? node : split(node, depth, makeLeaf(key, value));
+        }
+
+        shared_ptr<SparseMerkleNode>& child = smtKeyBit(key, depth) ? node->right : node->left;
+        child = update(child, depth + 1, key, value);
+        // ֻʣһʱΪҶӣ״ֻɼϾ
+        if (!node->left || !node->right) {
+            const shared_ptr<SparseMerkleNode>& only = node->left ? node->left : node->right;
+            if (!only || only->isLeaf) {
+                return only;
+            }
+        }
+        smtHashChildren(node->left, node->right, node->hash);
+        return node;
+    }
+
+    // ҶӷǵһͬλڵĲ㣬ϵ depth Ϊֹĸֻһǿӽڵ
+    static shared_ptr<SparseMerkleNode> split(shared_ptr<SparseMerkleNode> existing, int depth, shared_ptr<SparseMerkleNode> added) {
+        int divergence = smtFirstDifferentBit(existing->key, added->key, depth);
+        auto node = make_shared<SparseMerkleNode>();
+        if (smtKeyBit(added->key, divergence)) {
+            node->left = existing;
+            node->right = added;
+        }
+        else {
+            node->left = added;
+            node->right = existing;
+        }
+        smtHashChildren(node->left, node->right, node->hash);
+
+        for (int d = divergence - 1; d >= depth; --d) {
+            auto parent = make_shared<SparseMerkleNode>();
+            if (smtKeyBit(added->key, d)) {
+                parent->right = node;
+            }
+            else {
+                parent->left = node;
+            }
+            smtHashChildren(parent->left, parent->right, parent->hash);
+            node = parent;
+        }
+        return node;
+    }
+
+    shared_ptr<SparseMerkleNode> root;
+};
+
+inline bool verifySparseMerkleProof(const uint8_t rootHash[SM3_DIGEST_BYTES], const uint8_t key[SM3_DIGEST_BYTES],
+    const uint8_t valueHash[SM3_DIGEST_BYTES], const SparseMerkleProof& proof) {
+    if (proof.depth < 0 || proof.depth > SMT_DEPTH) {
+        return false;
+    }
+    uint8_t current[SM3_DIGEST_BYTES];
+    if (!isZeroHash(valueHash)) {
+        // ֤·ֹڼԼҶ
+        if (proof.hasOtherLeaf) {
+            return false;
+        }
+        smtHashLeaf(key, valueHash, current);
+    }
+    else if (proof.hasOtherLeaf) {
+        // ֤·ֹһҶӣü key ͬǰ depth λ
+        if (memcmp(proof.otherKey, key, SM3_DIGEST_BYTES) == 0 || isZeroHash(proof.otherValue) ||
+            smtFirstDifferentBit(proof.otherKey, key, 0) < proof.depth) {
+            return false;
+        }
+        smtHashLeaf(proof.otherKey, proof.otherValue, current);
+    }
+    else {
+        // ֤·ֹڿ
+        memcpy(current, SMT_EMPTY_HASH, SM3_DIGEST_BYTES);
+    }
+
+    size_t remaining = proof.siblings.size();
+    for (int depth = proof.depth - 1; depth >= 0; --depth) {
+        const uint8_t* sibling = SMT_EMPTY_HASH;
+        if ((proof.bitmap[depth >> 3] >> (7 - (depth & 7))) & 1) {
+            if (remaining == 0 || proof.siblings[remaining - 1].size() != SM3_DIGEST_BYTES) {
+                return false;
+            }
+            sibling = proof.siblings[--remaining].data();
+        }
+        if (smtKeyBit(key, depth)) {
+            hash_node_pair(sibling, current, current);
+        }
+        else {
+            hash_node_pair(current, sibling, current);
+        }
+    }
+    if (remaining != 0) {
+        return false;
+    }
+    return memcmp(current, rootHash, SM3_DIGEST_BYTES) == 0;
+}
+
+// Merkleļʽ̶ȵļͷ󰴲㣨0ΪҶӣ32ֽڹϣֵ
+// ÿʼλðҳ롣״ buildMerkleTree ͬԵϲ䵥Ľڵֱᡣ
+// blockHeight 0ʱΪֿ鲼֣ÿ blockHeight 㻮ΪһΣڸ߶Ϊ blockHeight ˳
+// һУblockHeight = 7 ʱһǡ4KBһҳlevelOffset[κ] Ϊεʼλá
+constexpr char MERKLE_FILE_MAGIC[8] = { 'S', 'M', '3', 'M', 'R', 'K', 'L', 'T' };
+constexpr uint32_t MERKLE_FILE_VERSION = 1;
+constexpr uint64_t MERKLE_FILE_ALIGNMENT = 4096;
+constexpr size_t MERKLE_FILE_CHUNK_NODES = 1 << 10;
+constexpr uint32_t MERKLE_PAGE_BLOCK_HEIGHT = 7;
+constexpr uint32_t MERKLE_MAX_BLOCK_HEIGHT = 16;
+
+struct MerkleFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t hashSize;
+    uint64_t leafCount;
+    uint32_t levelCount;
+    uint32_t blockHeight;
+    uint64_t levelOffset[MERKLE_MAX_DEPTH + 1];
+};
+
+static_assert(sizeof(MerkleFileHeader) <= MERKLE_FILE_ALIGNMENT, "Merkle file header must fit in the first page");
+
+inline uint64_t merkleLevelSize(uint64_t leafCount, uint32_t level) {
+    uint64_t count = leafCount;
+    for (uint32_t i = 0; i < level; ++i) {
+        count = (count + 1) / 2;
+    }
+    return count;
+}
+
+inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+inline uint64_t merkleBlockBytes(uint32_t blockHeight) {
+    return (static_cast<uint64_t>(1) << blockHeight) * SM3_DIGEST_BYTES;
+}
+
+inline uint32_t merkleBandTop(uint32_t band, uint32_t blockHeight, uint32_t levelCount) {
+    return min(band * blockHeight + blockHeight - 1, levelCount - 1);
+}
+
+inline bool initMerkleFileHeader(MerkleFileHeader& header, uint64_t leafCount, uint32_t blockHeight = 0) {
+    if (leafCount == 0 || blockHeight > MERKLE_MAX_BLOCK_HEIGHT) {
+        return false;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MERKLE_FILE_MAGIC, sizeof(header.magic));
+    header.version = MERKLE_FILE_VERSION;
+    header.hashSize = SM3_DIGEST_BYTES;
+    header.leafCount = leafCount;
+    header.blockHeight = blockHeight;
+
+    uint32_t levelCount = 1;
+    for (uint64_t count = leafCount; count > 1; count = (count + 1) / 2) {
+        ++levelCount;
+    }
+    header.levelCount = levelCount;
+
+    uint64_t offset = MERKLE_FILE_ALIGNMENT;
+    if (blockHeight == 0) {
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            header.levelOffset[level] = offset;
+            offset = alignUp(offset + merkleLevelSize(leafCount, level) * SM3_DIGEST_BYTES, MERKLE_FILE_ALIGNMENT);
+        }
+    }
+    else {
+        // Ķηǰ
+        uint32_t bandCount = (levelCount + blockHeight - 1) / blockHeight;
+        for (uint32_t band = bandCount; band-- > 0;) {
+            uint64_t blocks = merkleLevelSize(leafCount, merkleBandTop(band, blockHeight, levelCount));
+            header.levelOffset[band] = offset;
+            offset = alignUp(offset + blocks * merkleBlockBytes(blockHeight), MERKLE_FILE_ALIGNMENT);
+        }
+    }
+    return true;
+}
+
+inline uint64_t merkleFileSize(const MerkleFileHeader& header) {
+    if (header.blockHeight == 0) {
+        return alignUp(header.levelOffset[header.levelCount - 1] + SM3_DIGEST_BYTES, MERKLE_FILE_ALIGNMENT);
+    }
+    uint64_t blocks = merkleLevelSize(header.leafCount, merkleBandTop(0, header.blockHeight, header.levelCount));
+    return alignUp(header.levelOffset[0] + blocks * merkleBlockBytes(header.blockHeight), MERKLE_FILE_ALIGNMENT);
+}
+
+class MerkleNodeSink {
+public:
+    virtual ~MerkleNodeSink() {}
+    virtual bool writeNode(uint32_t level, uint64_t index, const uint8_t hash[SM3_DIGEST_BYTES]) = 0;
+};
+
+// Ҷӹϣֻÿ߶δϲ MERKLE_MAX_DEPTH 
+//  h λΪ1ʾ pending[h] ЧҶӼĶƱʾһһӦ
+//  sink ʱÿڵȷ󰴲˳һΣ䵥ĽڵҲڲ㣩
+class StreamingMerkleBuilder {
+public:
+    explicit StreamingMerkleBuilder(MerkleNodeSink* sink = nullptr) : sink(sink) {}
+
+    uint64_t leafCount() const {
+        return count;
+    }
+
+    bool addLeaf(const uint8_t hash[SM3_DIGEST_BYTES]) {
+        uint8_t node[SM3_DIGEST_BYTES];
+        memcpy(node, hash, SM3_DIGEST_BYTES);
+        if (!emit(0, count, node)) {
+            return false;
+        }
+        uint32_t height = 0;
+        while ((count >> height) & 1) {
+            hash_node_pair(pending[height], node, node);
+            ++height;
+            if (!emit(height, count >> height, node)) {
+                return false;
+            }
+        }
+        memcpy(pending[height], node, SM3_DIGEST_BYTES);
+        ++count;
+        return true;
+    }
+
+    bool finish(uint8_t rootHash[SM3_DIGEST_BYTES]) {
+        if (count == 0) {
+            return false;
+        }
+        uint32_t levelCount = 1;
+        for (uint64_t n = count; n > 1; n = (n + 1) / 2) {
+            ++levelCount;
+        }
+        if ((count & (count - 1)) == 0) {
+            memcpy(rootHash, pending[levelCount - 1], SM3_DIGEST_BYTES);
+            return true;
+        }
+
+        // ұԵϲĽڵ串ǷΧڸϲӵ͵۵Ľ
+        uint8_t acc[SM3_DIGEST_BYTES];
+        bool hasAcc = false;
+        for (uint32_t height = 0; height + 1 < levelCount; ++height) {
+            if ((count >> height) & 1) {
+                if (hasAcc) {
+                    hash_node_pair(pending[height], acc, acc);
+                }
+                else {
+                    memcpy(acc, pending[height], SM3_DIGEST_BYTES);
+                    hasAcc = true;
+                }
+            }
+            uint64_t mask = (static_cast<uint64_t>(1) << (height + 1)) - 1;
+            if ((count & mask) != 0 && !emit(height + 1, (count - 1) >> (height + 1), acc)) {
+                return false;
+            }
+        }
+        memcpy(rootHash, acc, SM3_DIGEST_BYTES);
+        return true;
+    }
+
+private:
+    bool emit(uint32_t level, uint64_t index, const uint8_t hash[SM3_DIGEST_BYTES]) {
+        return sink == nullptr || sink->writeNode(level, index, hash);
+    }
+
+    MerkleNodeSink* sink;
+    uint8_t pending[MERKLE_MAX_DEPTH][SM3_DIGEST_BYTES];
+    uint64_t count = 0;
+};
+
+// Ҷӹϣ StreamingMerkleBuilder ߶ߺϲڵдÿԵС
+// д̵òļеλáڴռΪ O(  С)Ҷ޹ء
+class MerkleFileWriter : public MerkleNodeSink {
+public:
+    MerkleFileWriter() : builder(this) {}
+
+    bool open(const string& path, uint64_t leafCount) {
+        if (!initMerkleFileHeader(header, leafCount)) {
+            return false;
+        }
+        file.open(path, ios::out | ios::binary | ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (uint32_t level = 0; level < header.levelCount; ++level) {
+            levelBuffers[level].clear();
+            levelFlushed[level] = 0;
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool appendLeaf(const uint8_t hash[SM3_DIGEST_BYTES]) {
+        if (builder.leafCount() == header.leafCount) {
+            return false;
+        }
+        return builder.addLeaf(hash);
+    }
+
+    bool finish(uint8_t rootHash[SM3_DIGEST_BYTES]) {
+        if (!file || builder.leafCount() != header.leafCount || !builder.finish(rootHash)) {
+            return false;
+        }
+        for (uint32_t level = 0; level < header.levelCount; ++level) {
+            if (!flushLevel(level) || levelFlushed[level] != merkleLevelSize(header.leafCount, level)) {
+                return false;
+            }
+        }
+        // ļĩβ뵽ҳ߽磬ֻӳҳ
+        uint64_t fileSize = merkleFileSize(header);
+        file.seekp(static_cast<streamoff>(fileSize - 1));
+        file.put(0);
+        file.close();
+        return !file.fail();
+    }
+
+    bool writeNode(uint32_t level, uint64_t index, const uint8_t hash[SM3_DIGEST_BYTES]) override {
+        vector<uint8_t>& buffer = levelBuffers[level];
+        if (index != levelFlushed[level] + buffer.size() / SM3_DIGEST_BYTES) {
+            return false;
+        }
+        buffer.insert(buffer.end(), hash, hash + SM3_DIGEST_BYTES);
+        if (buffer.size() >= MERKLE_FILE_CHUNK_NODES * SM3_DIGEST_BYTES) {
+            return flushLevel(level);
+        }
+        return true;
+    }
+
+private:
+    bool flushLevel(uint32_t level) {
+        vector<uint8_t>& buffer = levelBuffers[level];
+        if (buffer.empty()) {
+            return true;
+        }
+        file.seekp(static_cast<streamoff>(header.levelOffset[level] + levelFlushed[level] * SM3_DIGEST_BYTES));
+        file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<streamsize>(buffer.size()));
+        levelFlushed[level] += buffer.size() / SM3_DIGEST_BYTES;
+        buffer.clear();
+        return static_cast<bool>(file);
+    }
+
+    ofstream file;
+    MerkleFileHeader header;
+    StreamingMerkleBuilder builder;
+    vector<uint8_t> levelBuffers[MERKLE_MAX_DEPTH + 1];
+    uint64_t levelFlushed[MERKLE_MAX_DEPTH + 1];
+};
+
+inline bool writeMerkleFile(const string& path, const vector<vector<uint8_t>>& leafHashes, uint8_t rootHash[SM3_DIGEST_BYTES]) {
+    MerkleFileWriter writer;
+    if (!writer.open(path, leafHashes.size())) {
+        return false;
+    }
+    for (const auto& leaf : leafHashes) {
+        if (leaf.size() != SM3_DIGEST_BYTES || !writer.appendLeaf(leaf.data())) {
+            return false;
+        }
+    }
+    return writer.finish(rootHash);
+}
+
+// ӰʵMappedMerkleTreeMerkleLevelsռ֤Tree ṩ leafCountlevelCount  node
+// ֤ʽ verifyExistenceProofFast һ£proof[0] Ϊֵܽڵ㡣
+template <typename Tree>
+size_t collectExistenceProof(const Tree& tree, uint64_t index, uint8_t proof[][SM3_DIGEST_BYTES]) {
+    if (index >= tree.leafCount()) {
+        return 0;
+    }
+    uint64_t levelIndex[MERKLE_MAX_DEPTH];
+    uint32_t levels[MERKLE_MAX_DEPTH];
+    size_t depth = 0;
+    uint64_t count = tree.leafCount();
+    for (uint32_t level = 0; level + 1 < tree.levelCount(); ++level) {
+        uint64_t sibling = index ^ 1;
+        if (sibling < count) {
+            levels[depth] = level;
+            levelIndex[depth] = sibling;
+            ++depth;
+        }
+        index >>= 1;
+        count = (count + 1) / 2;
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        memcpy(proof[i], tree.node(levels[depth - 1 - i], levelIndex[depth - 1 - i]), SM3_DIGEST_BYTES);
+    }
+    return depth;
+}
+
+// ֻʽӳMerkleļʱֻУļͷɲϵͳҳ룬
+// һδֻ֤ᴥ O(log n) ҳ档
+class MappedMerkleTree {
+public:
+    MappedMerkleTree() = default;
+    MappedMerkleTree(const MappedMerkleTree&) = delete;
+    MappedMerkleTree& operator=(const MappedMerkleTree&) = delete;
+
+    ~MappedMerkleTree() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size)) {
+            close();
+            return false;
+        }
+        mappedSize = static_cast<uint64_t>(size.QuadPart);
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            close();
+            return false;
+        }
+        base = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (base == nullptr) {
+            close();
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MerkleFileHeader))) {
+            close();
+            return false;
+        }
+        mappedSize = static_cast<uint64_t>(st.st_size);
+        void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = static_cast<const uint8_t*>(addr);
+        madvise(addr, mappedSize, MADV_RANDOM);
+#endif
+        if (!validateHeader()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base != nullptr) {
+            UnmapViewOfFile(base);
+        }
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+            mappingHandle = nullptr;
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (base != nullptr) {
+            munmap(const_cast<uint8_t*>(base), mappedSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+        base = nullptr;
+        header = nullptr;
+        mappedSize = 0;
+    }
+
+    uint64_t leafCount() const {
+        return header->leafCount;
+    }
+
+    uint32_t levelCount() const {
+        return header->levelCount;
+    }
+
+    uint64_t levelSize(uint32_t level) const {
+        return merkleLevelSize(header->leafCount, level);
+    }
+
+    uint32_t blockHeight() const {
+        return header->blockHeight;
+    }
+
+    const uint8_t* node(uint32_t level, uint64_t index) const {
+        uint32_t k = header->blockHeight;
+        if (k == 0) {
+            return base + header->levelOffset[level] + index * SM3_DIGEST_BYTES;
+        }
+        uint32_t band = level / k;
+        uint32_t shift = merkleBandTop(band, k, header->levelCount) - level;
+        uint64_t block = index >> shift;
+        uint64_t slot = ((static_cast<uint64_t>(1) << shift) - 1) + (index - (block << shift));
+        return base + header->levelOffset[band] + block * merkleBlockBytes(k) + slot * SM3_DIGEST_BYTES;
+    }
+
+    const uint8_t* rootHash() const {
+        return node(header->levelCount - 1, 0);
+    }
+
+    // ǰ size Ҷӹɵʷ汾ĸϣ size ĶƷֽȡӦ۵
+    bool getRootAtSize(uint64_t size, uint8_t rootHash[SM3_DIGEST_BYTES]) const {
+        if (size == 0 || size > header->leafCount) {
+            return false;
+        }
+        bool hasAcc = false;
+        uint64_t end = size;
+        for (uint32_t level = 0; end > 0; ++level) {
+            uint64_t width = static_cast<uint64_t>(1) << level;
+            if ((size & width) == 0) {
+                continue;
+            }
+            end -= width;
+            const uint8_t* subtree = node(level, end >> level);
+            if (hasAcc) {
+                hash_node_pair(subtree, rootHash, rootHash);
+            }
+            else {
+                memcpy(rootHash, subtree, SM3_DIGEST_BYTES);
+                hasAcc = true;
+            }
+        }
+        return true;
+    }
+
+    // RFC 6962 2.1.2 һ֤֤ǰǰ oldSize Ҷӹɵ׷չ
+    // ֤еÿļѴ洢Ľڵ㣬ɹֻȡ O(log n) ڵ㡣
+    size_t getConsistencyProof(uint64_t oldSize, uint8_t proof[][SM3_DIGEST_BYTES]) const {
+        if (oldSize == 0 || oldSize >= header->leafCount) {
+            return 0;
+        }
+        size_t length = 0;
+        uint64_t lo = 0;
+        uint64_t hi = header->leafCount;
+        bool complete = true;
+        // ԶռRFC е˳⣬ٷת
+        while (oldSize != hi) {
+            uint64_t k = 1;
+            while (k * 2 < hi - lo) {
+                k *= 2;
+            }
+            if (oldSize <= lo + k) {
+                memcpy(proof[length++], rangeNode(lo + k, hi), SM3_DIGEST_BYTES);
+                hi = lo + k;
+            }
+            else {
+                memcpy(proof[length++], rangeNode(lo, lo + k), SM3_DIGEST_BYTES);
+                lo += k;
+                complete = false;
+            }
+        }
+        if (!complete) {
+            memcpy(proof[length++], rangeNode(lo, hi), SM3_DIGEST_BYTES);
+        }
+        reverse(proof, proof + length);
+        return length;
+    }
+
+    // ֤ʽ verifyExistenceProofFast һ£proof[0] Ϊֵܽڵ
+    size_t getExistenceProof(uint64_t index, uint8_t proof[][SM3_DIGEST_BYTES]) const {
+        return collectExistenceProof(*this, index, proof);
+    }
+
+private:
+    // Ҷ [lo, hi) Ľڵ㣬Ҫ lo  2^level  hi Ϊ lo + 2^level Ҷ
+    const uint8_t* rangeNode(uint64_t lo, uint64_t hi) const {
+        uint32_t level = 0;
+        while ((static_cast<uint64_t>(1) << level) < hi - lo) {
+            ++level;
+        }
+        return node(level, lo >> level);
+    }
+
+    bool validateHeader() {
+        if (mappedSize < sizeof(MerkleFileHeader)) {
+            return false;
+        }
+        const MerkleFileHeader* h = reinterpret_cast<const MerkleFileHeader*>(base);
+        MerkleFileHeader expected;
+        if (memcmp(h->magic, MERKLE_FILE_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != MERKLE_FILE_VERSION ||
+            h->hashSize != SM3_DIGEST_BYTES ||
+            !initMerkleFileHeader(expected, h->leafCount, h->blockHeight) ||
+            memcmp(expected.levelOffset, h->levelOffset, sizeof(expected.levelOffset)) != 0 ||
+            expected.levelCount != h->levelCount) {
+            return false;
+        }
+        if (merkleFileSize(*h) > mappedSize) {
+            return false;
+        }
+        header = h;
+        return true;
+    }
+
+    const uint8_t* base = nullptr;
+    const MerkleFileHeader* header = nullptr;
+    uint64_t mappedSize = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+constexpr size_t MERKLE_MAX_CONSISTENCY_PROOF = 2 * MERKLE_MAX_DEPTH;
+
+// RFC 9162 2.1.4.2 һ֤֤㷨
+inline bool verifyConsistencyProof(uint64_t oldSize, uint64_t newSize, const uint8_t oldRoot[SM3_DIGEST_BYTES], const uint8_t newRoot[SM3_DIGEST_BYTES],
+    const uint8_t proof[][SM3_DIGEST_BYTES], size_t length) {
+    if (oldSize == 0 || oldSize > newSize) {
+        return false;
+    }
+    if (oldSize == newSize) {
+        return length == 0 && memcmp(oldRoot, newRoot, SM3_DIGEST_BYTES) == 0;
+    }
+    if (length == 0) {
+        return false;
+    }
+
+    // СΪ2ʱеһڵ㣬֤ʡ
+    size_t next = 0;
+    uint8_t fr[SM3_DIGEST_BYTES];
+    uint8_t sr[SM3_DIGEST_BYTES];
+    if ((oldSize & (oldSize - 1)) == 0) {
+        memcpy(fr, oldRoot, SM3_DIGEST_BYTES);
+    }
+    else {
+        memcpy(fr, proof[next++], SM3_DIGEST_BYTES);
+    }
+    memcpy(sr, fr, SM3_DIGEST_BYTES);
+
+    uint64_t fn = oldSize - 1;
+    uint64_t sn = newSize - 1;
+    while (fn & 1) {
+        fn >>= 1;
+        sn >>= 1;
+    }
+    for (; next < length; ++next) {
+        if (sn == 0) {
+            return false;
+        }
+        if ((fn & 1) || fn == sn) {
+            hash_node_pair(proof[next], fr, fr);
+            hash_node_pair(proof[next], sr, sr);
+            while ((fn & 1) == 0 && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        }
+        else {
+            hash_node_pair(sr, proof[next], sr);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    return sn == 0 && memcmp(fr, oldRoot, SM3_DIGEST_BYTES) == 0 && memcmp(sr, newRoot, SM3_DIGEST_BYTES) == 0;
+}
+
+// еMerkleļΪֿ鲼֡ļе˳дÿֻһ顣
+inline bool writeBlockedMerkleFile(const MappedMerkleTree& source, const string& path, uint32_t blockHeight = MERKLE_PAGE_BLOCK_HEIGHT) {
+    MerkleFileHeader header;
+    if (blockHeight == 0 || !initMerkleFileHeader(header, source.leafCount(), blockHeight)) {
+        return false;
+    }
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    vector<uint8_t> block(merkleBlockBytes(blockHeight));
+    uint32_t bandCount = (header.levelCount + blockHeight - 1) / blockHeight;
+    for (uint32_t band = bandCount; band-- > 0;) {
+        uint32_t bottom = band * blockHeight;
+        uint32_t top = merkleBandTop(band, blockHeight, header.levelCount);
+        uint64_t blocks = merkleLevelSize(header.leafCount, top);
+        file.seekp(static_cast<streamoff>(header.levelOffset[band]));
+        for (uint64_t b = 0; b < blocks; ++b) {
+            fill(block.begin(), block.end(), 0);
+            for (uint32_t level = top + 1; level-- > bottom;) {
+                uint32_t shift = top - level;
+                uint64_t first = b << shift;
+                uint64_t last = min((b + 1) << shift, source.levelSize(level));
+                uint64_t slot = (static_cast<uint64_t>(1) << shift) - 1;
+                if (first < last) {
+                    memcpy(&block[slot * SM3_DIGEST_BYTES], source.node(level, first), (last - first) * SM3_DIGEST_BYTES);
+                }
+            }
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<streamsize>(block.size()));
+        }
+    }
+    uint64_t fileSize = merkleFileSize(header);
+    file.seekp(static_cast<streamoff>(fileSize - 1));
+    file.put(0);
+    file.close();
+    return !file.fail();
+}
+// ڴаŵMerklelevels[0] ΪҶӹϣ״ļʽеİ㲼ͬ
+class MerkleLevels {
+public:
+    uint64_t leafCount() const {
+        return levels.empty() ? 0 : levels[0].size() / SM3_DIGEST_BYTES;
+    }
+
+    uint32_t levelCount() const {
+        return static_cast<uint32_t>(levels.size());
+    }
+
+    uint64_t levelSize(uint32_t level) const {
+        return levels[level].size() / SM3_DIGEST_BYTES;
+    }
+
+    const uint8_t* node(uint32_t level, uint64_t index) const {
+        return &levels[level][index * SM3_DIGEST_BYTES];
+    }
+
+    const uint8_t* rootHash() const {
+        return levels.back().data();
+    }
+
+    size_t getExistenceProof(uint64_t index, uint8_t proof[][SM3_DIGEST_BYTES]) const {
+        return collectExistenceProof(*this, index, proof);
+    }
+
+private:
+    friend bool buildMerkleLevels(const uint8_t* leafHashes, uint64_t leafCount, unsigned threadCount, MerkleLevels& tree);
+
+    vector<vector<uint8_t>> levels;
+};
+
+//  parent  [first, last) ΧڵĽڵ㣬䵥һӽڵֱ
+inline void hashMerkleLevelRange(const uint8_t* children, uint64_t childCount, uint8_t* parents, uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i < last; ++i) {
+        const uint8_t* left = children + 2 * i * SM3_DIGEST_BYTES;
+        if (2 * i + 1 < childCount) {
+            hash_node_pair(left, left + SM3_DIGEST_BYTES, parents + i * SM3_DIGEST_BYTES);
+        }
+        else {
+            memcpy(parents + i * SM3_DIGEST_BYTES, left, SM3_DIGEST_BYTES);
+        }
+    }
+}
+
+// ÿ߳ٷֵĽڵСֱڵǰ߳ɣ̴߳
+constexpr uint64_t MERKLE_MIN_NODES_PER_THREAD = 1 << 12;
+
+// 㹹MerkleÿĽڵƽָ threadCount ̼߳㣬 buildMerkleTree ĸϣͬ
+inline bool buildMerkleLevels(const uint8_t* leafHashes, uint64_t leafCount, unsigned threadCount, MerkleLevels& tree) {
+    tree.levels.clear();
+    if (leafCount == 0) {
+        return false;
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    tree.levels.emplace_back(leafHashes, leafHashes + leafCount * SM3_DIGEST_BYTES);
+    vector<thread> workers;
+    for (uint64_t count = leafCount; count > 1; count = (count + 1) / 2) {
+        uint64_t parentCount = (count + 1) / 2;
+        tree.levels.emplace_back(parentCount * SM3_DIGEST_BYTES);
+        const uint8_t* children = tree.levels[tree.levels.size() - 2].data();
+        uint8_t* parents = tree.levels.back().data();
+
+        uint64_t threads = min<uint64_t>(threadCount, max<uint64_t>(1, parentCount / MERKLE_MIN_NODES_PER_THREAD));
+        uint64_t perThread = (parentCount + threads - 1) / threads;
+        workers.clear();
+        for (uint64_t t = 1; t < threads; ++t) {
+            uint64_t first = t * perThread;
+            uint64_t last = min(first + perThread, parentCount);
+            workers.emplace_back(hashMerkleLevelRange, children, count, parents, first, last);
+        }
+        hashMerkleLevelRange(children, count, parents, 0, min(perThread, parentCount));
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    return true;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "../Project4_3/merkle.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// 滻ȫ operator new/deleteͳƸ׶εĶѷֽ
+static atomic<uint64_t> g_allocCount(0);
+static atomic<uint64_t> g_allocBytes(0);
+
+void* operator new(size_t size) {
+    g_allocCount.fetch_add(1, memory_order_relaxed);
+    g_allocBytes.fetch_add(size, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+//  operator new  malloc 䣬֮ free ͷšGCC  new ʽΪڽ䣬
+// Щ滻汾 -Wmismatched-new-delete⼸崦رոþ
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// ļϵͳҳʹʲʵĴȱҳ
+void evictFileCache(const string& path) {
+#ifdef _WIN32
+    // ޻巽ʽٹرļʹļĻҳʧЧ
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+uint64_t currentPageFaults() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PageFaultCount;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_minflt + usage.ru_majflt);
+#endif
+}
+
+// ķֵפڴ棨ֽڣ
+uint64_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// ԱȰ㲼ֿ鲼ɴ֤ĺʱȱҳҶΪŵSM3ϣ
+// ֱʽдļڴбҶӡ
+void runLayoutBenchmark(const vector<uint64_t>& leafCounts, size_t proofCount) {
+    cout << "Ҷ\t\tļС(MB)\tƽ֤ʱ(us)\tƽȱҳ" << endl;
+    for (uint64_t leafCount : leafCounts) {
+        const string levelPath = "merkle_level.bin";
+        const string blockedPath = "merkle_blocked.bin";
+
+        MerkleFileWriter writer;
+        if (!writer.open(levelPath, leafCount)) {
+            cout << "޷ļ " << levelPath << endl;
+            return;
+        }
+        uint8_t leaf[SM3_DIGEST_BYTES];
+        for (uint64_t i = 0; i < leafCount; ++i) {
+            hash_leaf(reinterpret_cast<const uint8_t*>(&i), sizeof(i), leaf);
+            writer.appendLeaf(leaf);
+        }
+        uint8_t rootHash[SM3_DIGEST_BYTES];
+        if (!writer.finish(rootHash)) {
+            cout << "дļ " << levelPath << " ʧ" << endl;
+            return;
+        }
+        {
+            MappedMerkleTree levelTree;
+            if (!levelTree.open(levelPath) || !writeBlockedMerkleFile(levelTree, blockedPath)) {
+                cout << "дļ " << blockedPath << " ʧ" << endl;
+                return;
+            }
+        }
+
+        mt19937_64 gen(leafCount);
+        vector<uint64_t> indices(proofCount);
+        for (auto& index : indices) {
+            index = gen() % leafCount;
+        }
+
+        const string paths[2] = { levelPath, blockedPath };
+        const char* names[2] = { "", "ֿ" };
+        for (int layout = 0; layout < 2; ++layout) {
+            evictFileCache(paths[layout]);
+            MappedMerkleTree tree;
+            if (!tree.open(paths[layout]) || memcmp(tree.rootHash(), rootHash, SM3_DIGEST_BYTES) != 0) {
+                cout << "ļ " << paths[layout] << " Уʧ" << endl;
+                return;
+            }
+            uint8_t proof[MERKLE_MAX_DEPTH][SM3_DIGEST_BYTES];
+            size_t depth = 0;
+            uint64_t faultsBefore = currentPageFaults();
+            auto start = chrono::high_resolution_clock::now();
+            for (uint64_t index : indices) {
+                depth = tree.getExistenceProof(index, proof);
+            }
+            auto end = chrono::high_resolution_clock::now();
+            uint64_t faults = currentPageFaults() - faultsBefore;
+
+            hash_leaf(reinterpret_cast<const uint8_t*>(&indices.back()), sizeof(uint64_t), leaf);
+            if (!verifyExistenceProofFast(tree.rootHash(), leaf, indices.back(), leafCount, proof, depth)) {
+                cout << "ļ " << paths[layout] << " ɵ֤Ч" << endl;
+                return;
+            }
+
+            chrono::duration<double, micro> duration = end - start;
+            ifstream sizeProbe(paths[layout], ios::binary | ios::ate);
+            double fileMB = static_cast<double>(sizeProbe.tellg()) / (1024.0 * 1024.0);
+            cout << leafCount << "\t" << names[layout] << "\t" << fileMB << "\t"
+                << duration.count() / proofCount << "\t" << static_cast<double>(faults) / proofCount << endl;
+        }
+    }
+}
+
+// ¼һԽ׶εĺʱڼĶѷ䣬ʱһƱָĽ
+class BenchStage {
+public:
+    BenchStage(uint64_t leafCount, const char* name, unsigned threads)
+        : leafCount(leafCount), name(name), threads(threads),
+        allocCount(g_allocCount.load()), allocBytes(g_allocBytes.load()),
+        start(chrono::high_resolution_clock::now()) {
+    }
+
+    // items Ϊý׶δĶҶӡڵ֤ڼ
+    double finish(uint64_t items) {
+        chrono::duration<double> seconds = chrono::high_resolution_clock::now() - start;
+        uint64_t allocs = g_allocCount.load() - allocCount;
+        uint64_t bytes = g_allocBytes.load() - allocBytes;
+        cout << leafCount << "\t" << name << "\t" << threads << "\t" << items << "\t"
+            << seconds.count() * 1000.0 << "\t" << items / seconds.count() << "\t"
+            << peakResidentBytes() / (1024.0 * 1024.0) << "\t" << allocs << "\t"
+            << bytes / (1024.0 * 1024.0) << endl;
+        return seconds.count();
+    }
+
+private:
+    uint64_t leafCount;
+    const char* name;
+    unsigned threads;
+    uint64_t allocCount;
+    uint64_t allocBytes;
+    chrono::high_resolution_clock::time_point start;
+};
+
+// ֤ҪָֻҶֵʱ
+constexpr uint64_t NON_EXISTENCE_MAX_LEAVES = 1000000;
+constexpr size_t NON_EXISTENCE_QUERIES = 10;
+// ϡMerkleÿβԼ log2(n) ιϣÿڵ㵥䣬ļԴΪ
+constexpr uint64_t SPARSE_MAX_KEYS = 1000000;
+constexpr size_t PROOF_COUNT = 10000;
+
+// βҶӹϣ֤֤֤֤߳̽
+// ֵפڴΪ̼ĵֵҶԣÿзӳùģΪֹڴ
+bool runSuite(uint64_t maxLeaves, unsigned maxThreads) {
+    vector<unsigned> threadCounts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    cout << "Ҷ\t׶\t߳\t\tʱ(ms)\t(/)\tֵRSS(MB)\t\tֽ(MB)" << endl;
+    for (uint64_t leafCount = 1000; leafCount <= maxLeaves; leafCount *= 10) {
+        vector<uint8_t> leaves;
+        {
+            BenchStage stage(leafCount, "Ҷӹϣ", 1);
+            leaves.resize(leafCount * SM3_DIGEST_BYTES);
+            for (uint64_t i = 0; i < leafCount; ++i) {
+                hash_leaf(reinterpret_cast<const uint8_t*>(&i), sizeof(i), &leaves[i * SM3_DIGEST_BYTES]);
+            }
+            stage.finish(leafCount);
+        }
+
+        MerkleLevels tree;
+        uint8_t rootHash[SM3_DIGEST_BYTES];
+        double baseSeconds = 0;
+        for (unsigned threads : threadCounts) {
+            tree = MerkleLevels();
+            BenchStage stage(leafCount, "", threads);
+            buildMerkleLevels(leaves.data(), leafCount, threads, tree);
+            double seconds = stage.finish(leafCount - 1);
+            if (threads == 1) {
+                baseSeconds = seconds;
+                memcpy(rootHash, tree.rootHash(), SM3_DIGEST_BYTES);
+            }
+            else {
+                cout << "#\t" << threads << " ̼߳ٱ\t" << baseSeconds / seconds << endl;
+                if (memcmp(rootHash, tree.rootHash(), SM3_DIGEST_BYTES) != 0) {
+                    cout << "̹߳ĸϣֵһ" << endl;
+                    return false;
+                }
+            }
+        }
+
+        mt19937_64 gen(leafCount);
+        vector<uint64_t> indices(PROOF_COUNT);
+        for (auto& index : indices) {
+            index = gen() % leafCount;
+        }
+        vector<uint8_t> proofs(PROOF_COUNT * MERKLE_MAX_DEPTH * SM3_DIGEST_BYTES);
+        vector<size_t> depths(PROOF_COUNT);
+        auto proofAt = [&](size_t i) {
+            return reinterpret_cast<uint8_t(*)[SM3_DIGEST_BYTES]>(&proofs[i * MERKLE_MAX_DEPTH * SM3_DIGEST_BYTES]);
+        };
+        {
+            BenchStage stage(leafCount, "֤", 1);
+            for (size_t i = 0; i < PROOF_COUNT; ++i) {
+                depths[i] = tree.getExistenceProof(indices[i], proofAt(i));
+            }
+            stage.finish(PROOF_COUNT);
+        }
+        size_t valid = 0;
+        {
+            BenchStage stage(leafCount, "֤", 1);
+            for (size_t i = 0; i < PROOF_COUNT; ++i) {
+                valid += verifyExistenceProofFast(rootHash, tree.node(0, indices[i]), indices[i], leafCount, proofAt(i), depths[i]);
+            }
+            stage.finish(PROOF_COUNT);
+        }
+        if (valid != PROOF_COUNT) {
+            cout << "֤֤ʧ " << PROOF_COUNT - valid << " " << endl;
+            return false;
+        }
+
+        // ĿȡҶӵԭϣ֤
+        vector<vector<uint8_t>> targets(NON_EXISTENCE_QUERIES);
+        for (size_t i = 0; i < NON_EXISTENCE_QUERIES; ++i) {
+            uint64_t index = indices[i];
+            sm3_hash(reinterpret_cast<const uint8_t*>(&index), sizeof(index), targets[i]);
+        }
+
+        if (leafCount <= NON_EXISTENCE_MAX_LEAVES) {
+            vector<vector<uint8_t>> leafHashes;
+            shared_ptr<MerkleNode> root;
+            {
+                BenchStage stage(leafCount, "ָ", 1);
+                leafHashes.reserve(leafCount);
+                for (uint64_t i = 0; i < leafCount; ++i) {
+                    leafHashes.emplace_back(tree.node(0, i), tree.node(0, i) + SM3_DIGEST_BYTES);
+                }
+                root = buildMerkleTree(leafHashes, 0, leafHashes.size() - 1);
+                stage.finish(leafCount - 1);
+            }
+            size_t absent = 0;
+            {
+                BenchStage stage(leafCount, "֤", 1);
+                for (const auto& target : targets) {
+                    vector<vector<uint8_t>> proofPath;
+                    absent += getNonExistenceProof(root, target, proofPath);
+                }
+                stage.finish(NON_EXISTENCE_QUERIES);
+            }
+            if (absent != NON_EXISTENCE_QUERIES) {
+                cout << "֤ʧ" << endl;
+                return false;
+            }
+        }
+
+        if (leafCount <= SPARSE_MAX_KEYS) {
+            SparseMerkleTree sparseTree;
+            {
+                BenchStage stage(leafCount, "ϡ", 1);
+                for (uint64_t i = 0; i < leafCount; ++i) {
+                    sparseTree.update(tree.node(0, i), tree.node(0, i));
+                }
+                stage.finish(leafCount);
+            }
+            uint8_t sparseRoot[SM3_DIGEST_BYTES];
+            sparseTree.rootHash(sparseRoot);
+            vector<SparseMerkleProof> absenceProofs(NON_EXISTENCE_QUERIES);
+            {
+                BenchStage stage(leafCount, "ϡ֤", 1);
+                for (size_t i = 0; i < NON_EXISTENCE_QUERIES; ++i) {
+                    absenceProofs[i] = sparseTree.getProof(targets[i].data());
+                }
+                stage.finish(NON_EXISTENCE_QUERIES);
+            }
+            const uint8_t emptyValue[SM3_DIGEST_BYTES] = { 0 };
+            size_t absent = 0;
+            {
+                BenchStage stage(leafCount, "ϡ֤", 1);
+                for (size_t i = 0; i < NON_EXISTENCE_QUERIES; ++i) {
+                    absent += verifySparseMerkleProof(sparseRoot, targets[i].data(), emptyValue, absenceProofs[i]);
+                }
+                stage.finish(NON_EXISTENCE_QUERIES);
+            }
+            if (absent != NON_EXISTENCE_QUERIES) {
+                cout << "ϡ֤֤ʧ" << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    cout << fixed << setprecision(3);
+    if (argc > 1 && string(argv[1]) == "layout") {
+        // ÷: Project4_3_bench layout [Ҷ...]Ĭβ 10^6 ~ 10^9 Ҷ
+        vector<uint64_t> leafCounts;
+        for (int i = 2; i < argc; ++i) {
+            leafCounts.push_back(stoull(argv[i]));
+        }
+        if (leafCounts.empty()) {
+            leafCounts = { 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL };
+        }
+        runLayoutBenchmark(leafCounts, 10000);
+        return 0;
+    }
+
+    // ÷: Project4_3_bench [Ҷ] [߳]Ҷ 10^3 10Ĭϵ 10^8
+    uint64_t maxLeaves = argc > 1 ? stoull(argv[1]) : 100000000ULL;
+    unsigned maxThreads = argc > 2 ? static_cast<unsigned>(stoul(argv[2])) : thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+    return runSuite(maxLeaves, maxThreads) ? 0 : -1;
+}
\ No newline at end of file
@@ -0,0 +1,1824 @@
+#ifndef SM2_H
+#define SM2_H
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "sm3.h"
+
+//  SM2_USE_MULX -mbmi2 -madx 룩ʱ˷ʹ MULXλ _addcarryx_u64 д
+// Ƿ ADCX/ADOX ɱGCC/Clang Ŀǰͨ ADCֻ MULX б֤ġ
+//  x64 MSVC  _umul128/_addcarry_u64ƽ̨ÿֲCʵ
+#if defined(__BMI2__) && defined(__ADX__) && !defined(SM2_USE_MULX)
+#define SM2_USE_MULX
+#endif
+#if defined(SM2_USE_MULX)
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+// GB/T 32918 SM2 ǩ빫ԿܣʹƼ256λ y^2 = x^3 + ax + b (a = p - 3)
+// 464λС˴ţԪڵʼΪģ p  Montgomery ʽ (R = 2^256)
+constexpr int SM2_WORDS = 4;
+constexpr int SM2_BYTES = 32;
+constexpr int SM2_WINDOW_BITS = 4;
+constexpr int SM2_WINDOW_SIZE = 1 << SM2_WINDOW_BITS;
+
+const uint8_t SM2_A[SM2_BYTES] = {
+    0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC
+};
+const uint8_t SM2_B[SM2_BYTES] = {
+    0x28, 0xE9, 0xFA, 0x9E, 0x9D, 0x9F, 0x5E, 0x34, 0x4D, 0x5A, 0x9E, 0x4B, 0xCF, 0x65, 0x09, 0xA7,
+    0xF3, 0x97, 0x89, 0xF5, 0x15, 0xAB, 0x8F, 0x92, 0xDD, 0xBC, 0xBD, 0x41, 0x4D, 0x94, 0x0E, 0x93
+};
+const uint8_t SM2_GX[SM2_BYTES] = {
+    0x32, 0xC4, 0xAE, 0x2C, 0x1F, 0x19, 0x81, 0x19, 0x5F, 0x99, 0x04, 0x46, 0x6A, 0x39, 0xC9, 0x94,
+    0x8F, 0xE3, 0x0B, 0xBF, 0xF2, 0x66, 0x0B, 0xE1, 0x71, 0x5A, 0x45, 0x89, 0x33, 0x4C, 0x74, 0xC7
+};
+const uint8_t SM2_GY[SM2_BYTES] = {
+    0xBC, 0x37, 0x36, 0xA2, 0xF4, 0xF6, 0x77, 0x9C, 0x59, 0xBD, 0xCE, 0xE3, 0x6B, 0x69, 0x21, 0x53,
+    0xD0, 0xA9, 0x87, 0x7C, 0xC6, 0x2A, 0x47, 0x40, 0x02, 0xDF, 0x32, 0xE5, 0x21, 0x39, 0xF0, 0xA0
+};
+
+// δָûʱʹñ׼ĬID
+const char SM2_DEFAULT_ID[] = "1234567812345678";
+
+struct sm2_bn {
+    uint64_t v[SM2_WORDS];
+};
+
+// ģ m  Montgomery R = 2^256
+struct sm2_mont_ctx {
+    sm2_bn m;
+    uint64_t m0inv;  // -m^-1 mod 2^64
+    sm2_bn one;      // R mod m
+    sm2_bn rr;       // R^2 mod m
+};
+
+// p = 2^256 - 2^224 - 2^96 + 2^64 - 1p  -1 (mod 2^64)
+const sm2_mont_ctx SM2_FIELD = {
+    { { 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFEFFFFFFFFULL } },
+    1,
+    { { 0x0000000000000001ULL, 0x00000000FFFFFFFFULL, 0x0000000000000000ULL, 0x0000000100000000ULL } },
+    { { 0x0000000200000003ULL, 0x00000002FFFFFFFFULL, 0x0000000100000001ULL, 0x0000000400000002ULL } }
+};
+
+const sm2_mont_ctx SM2_ORDER = {
+    { { 0x53BBF40939D54123ULL, 0x7203DF6B21C6052BULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFEFFFFFFFFULL } },
+    0x327F9E8872350975ULL,
+    { { 0xAC440BF6C62ABEDDULL, 0x8DFC2094DE39FAD4ULL, 0x0000000000000000ULL, 0x0000000100000000ULL } },
+    { { 0x901192AF7C114F20ULL, 0x3464504ADE6FA2FAULL, 0x620FC84C3AFFE0D4ULL, 0x1EB5E412A22B3D3BULL } }
+};
+
+// 64x64 -> 128 λ˷ص64λ
+inline uint64_t sm2_mul_wide(uint64_t a, uint64_t b, uint64_t* hi) {
+#if defined(SM2_USE_MULX)
+    unsigned long long h;
+    uint64_t lo = _mulx_u64(a, b, &h);
+    *hi = h;
+    return lo;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, hi);
+#elif defined(__SIZEOF_INT128__)
+    unsigned __int128 t = static_cast<unsigned __int128>(a) * b;
+    *hi = static_cast<uint64_t>(t >> 64);
+    return static_cast<uint64_t>(t);
+#else
+    uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32;
+    uint64_t b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return (mid << 32) | (p00 & 0xFFFFFFFF);
+#endif
+}
+
+// λӷʹλµĽλ/λ
+inline unsigned char sm2_adc(unsigned char carry, uint64_t a, uint64_t b, uint64_t* r) {
+#if defined(SM2_USE_MULX)
+    unsigned long long t;
+    carry = _addcarryx_u64(carry, a, b, &t);
+    *r = t;
+    return carry;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _addcarry_u64(carry, a, b, r);
+#else
+    uint64_t t = a + carry;
+    unsigned char c = t < carry;
+    t += b;
+    c |= t < b;
+    *r = t;
+    return c;
+#endif
+}
+
+inline unsigned char sm2_sbb(unsigned char borrow, uint64_t a, uint64_t b, uint64_t* r) {
+#if defined(SM2_USE_MULX) || (defined(_MSC_VER) && defined(_M_X64))
+    unsigned long long t;
+    borrow = _subborrow_u64(borrow, a, b, &t);
+    *r = t;
+    return borrow;
+#else
+    uint64_t t = a - b;
+    unsigned char c = a < b;
+    c |= t < borrow;
+    *r = t - borrow;
+    return c;
+#endif
+}
+
+inline void sm2_bn_from_bytes(sm2_bn& r, const uint8_t bytes[SM2_BYTES]) {
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        const uint8_t* p = bytes + SM2_BYTES - 8 * (i + 1);
+        uint64_t w = 0;
+        for (int j = 0; j < 8; ++j) {
+            w = (w << 8) | p[j];
+        }
+        r.v[i] = w;
+    }
+}
+
+inline void sm2_bn_to_bytes(const sm2_bn& a, uint8_t bytes[SM2_BYTES]) {
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        uint8_t* p = bytes + SM2_BYTES - 8 * (i + 1);
+        for (int j = 0; j < 8; ++j) {
+            p[j] = static_cast<uint8_t>(a.v[i] >> (56 - 8 * j));
+        }
+    }
+}
+
+inline void sm2_bn_set_word(sm2_bn& r, uint64_t w) {
+    memset(r.v, 0, sizeof(r.v));
+    r.v[0] = w;
+}
+
+inline bool sm2_bn_is_zero(const sm2_bn& a) {
+    uint64_t acc = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        acc |= a.v[i];
+    }
+    return acc == 0;
+}
+
+inline bool sm2_bn_equal(const sm2_bn& a, const sm2_bn& b) {
+    uint64_t acc = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        acc |= a.v[i] ^ b.v[i];
+    }
+    return acc == 0;
+}
+
+inline int sm2_bn_cmp(const sm2_bn& a, const sm2_bn& b) {
+    for (int i = SM2_WORDS - 1; i >= 0; --i) {
+        if (a.v[i] != b.v[i]) {
+            return a.v[i] < b.v[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+inline unsigned char sm2_bn_add(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    unsigned char carry = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        carry = sm2_adc(carry, a.v[i], b.v[i], &r.v[i]);
+    }
+    return carry;
+}
+
+inline unsigned char sm2_bn_sub(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    unsigned char borrow = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        borrow = sm2_sbb(borrow, a.v[i], b.v[i], &r.v[i]);
+    }
+    return borrow;
+}
+
+inline int sm2_bn_bit(const sm2_bn& a, int i) {
+    return static_cast<int>((a.v[i >> 6] >> (i & 63)) & 1);
+}
+
+// λ top  a ɵȥ mλȡѡ񣬲ݷ֧
+inline void sm2_bn_sub_if_ge(sm2_bn& r, const uint64_t a[SM2_WORDS], uint64_t top, const sm2_bn& m) {
+    uint64_t s[SM2_WORDS], dummy;
+    unsigned char borrow = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        borrow = sm2_sbb(borrow, a[i], m.v[i], &s[i]);
+    }
+    borrow = sm2_sbb(borrow, top, 0, &dummy);
+    uint64_t keep = 0 - static_cast<uint64_t>(borrow);
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        r.v[i] = (a[i] & keep) | (s[i] & ~keep);
+    }
+}
+
+inline void sm2_mod_add(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    sm2_bn t;
+    unsigned char carry = sm2_bn_add(t, a, b);
+    sm2_bn_sub_if_ge(r, t.v, carry, ctx.m);
+}
+
+inline void sm2_mod_sub(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    sm2_bn t, s;
+    uint64_t mask = 0 - static_cast<uint64_t>(sm2_bn_sub(t, a, b));
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        s.v[i] = ctx.m.v[i] & mask;
+    }
+    sm2_bn_add(r, t, s);
+}
+
+//  [0, 2m) ڵԼ [0, m)
+inline void sm2_mod_reduce_once(const sm2_mont_ctx& ctx, sm2_bn& a) {
+    sm2_bn_sub_if_ge(a, a.v, 0, ctx.m);
+}
+
+// ͨ CIOS Montgomery ˷r = a * b * R^-1 mod mģ n
+inline void sm2_mont_mul(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    uint64_t t[SM2_WORDS + 2] = { 0 };
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        uint64_t carry = 0, hi, lo;
+        unsigned char c;
+        for (int j = 0; j < SM2_WORDS; ++j) {
+            lo = sm2_mul_wide(a.v[j], b.v[i], &hi);
+            c = sm2_adc(0, lo, t[j], &lo);
+            hi += c;
+            c = sm2_adc(0, lo, carry, &t[j]);
+            carry = hi + c;
+        }
+        c = sm2_adc(0, t[SM2_WORDS], carry, &t[SM2_WORDS]);
+        t[SM2_WORDS + 1] = c;
+
+        uint64_t u = t[0] * ctx.m0inv;
+        lo = sm2_mul_wide(u, ctx.m.v[0], &hi);
+        c = sm2_adc(0, lo, t[0], &lo);
+        carry = hi + c;
+        for (int j = 1; j < SM2_WORDS; ++j) {
+            lo = sm2_mul_wide(u, ctx.m.v[j], &hi);
+            c = sm2_adc(0, lo, t[j], &lo);
+            hi += c;
+            c = sm2_adc(0, lo, carry, &t[j - 1]);
+            carry = hi + c;
+        }
+        c = sm2_adc(0, t[SM2_WORDS], carry, &t[SM2_WORDS - 1]);
+        t[SM2_WORDS] = t[SM2_WORDS + 1] + c;
+    }
+    sm2_bn_sub_if_ge(r, t, t[SM2_WORDS], ctx.m);
+}
+
+inline void sm2_to_mont(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a) {
+    sm2_mont_mul(ctx, r, a, ctx.rr);
+}
+
+inline void sm2_from_mont(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a) {
+    sm2_bn one;
+    sm2_bn_set_word(one, 1);
+    sm2_mont_mul(ctx, r, a, one);
+}
+
+// С棺a^(m-2)Ϊ Montgomery ʽ
+inline void sm2_mont_inv(const sm2_mont_ctx& ctx, sm2_bn& r, const sm2_bn& a) {
+    sm2_bn two, e;
+    sm2_bn_set_word(two, 2);
+    sm2_bn_sub(e, ctx.m, two);
+    sm2_bn acc = ctx.one;
+    for (int i = 255; i >= 0; --i) {
+        sm2_mont_mul(ctx, acc, acc, acc);
+        if (sm2_bn_bit(e, i)) {
+            sm2_mont_mul(ctx, acc, acc, a);
+        }
+    }
+    r = acc;
+}
+
+// 4x4 ֵĳ˻ÿ b[i]  a Ĳֻ64λ͸64λһλ
+// ϻͬһλ־δֵ ADCX/ADOX  CFOF 
+inline void sm2_mul_512(uint64_t t[2 * SM2_WORDS], const sm2_bn& a, const sm2_bn& b) {
+    memset(t, 0, 2 * SM2_WORDS * sizeof(uint64_t));
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        uint64_t lo[SM2_WORDS], hi[SM2_WORDS];
+        for (int j = 0; j < SM2_WORDS; ++j) {
+            lo[j] = sm2_mul_wide(a.v[j], b.v[i], &hi[j]);
+        }
+        unsigned char c_lo = 0, c_hi = 0;
+        for (int j = 0; j < SM2_WORDS; ++j) {
+            c_lo = sm2_adc(c_lo, t[i + j], lo[j], &t[i + j]);
+            c_hi = sm2_adc(c_hi, t[i + j + 1], hi[j], &t[i + j + 1]);
+        }
+        // ֺС 2^(64(i+5))ּϵλĽλ
+        t[i + SM2_WORDS] += c_lo;
+    }
+}
+
+// ƽֻһ뽻һλټ϶Խ
+inline void sm2_sqr_512(uint64_t t[2 * SM2_WORDS], const sm2_bn& a) {
+    memset(t, 0, 2 * SM2_WORDS * sizeof(uint64_t));
+    for (int i = 0; i < SM2_WORDS - 1; ++i) {
+        unsigned char c_lo = 0, c_hi = 0;
+        for (int j = i + 1; j < SM2_WORDS; ++j) {
+            uint64_t hi, lo = sm2_mul_wide(a.v[i], a.v[j], &hi);
+            c_lo = sm2_adc(c_lo, t[i + j], lo, &t[i + j]);
+            c_hi = sm2_adc(c_hi, t[i + j + 1], hi, &t[i + j + 1]);
+        }
+        t[i + SM2_WORDS] += c_lo;
+    }
+    for (int i = 2 * SM2_WORDS - 1; i > 0; --i) {
+        t[i] = (t[i] << 1) | (t[i - 1] >> 63);
+    }
+    t[0] <<= 1;
+    unsigned char carry = 0;
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        uint64_t hi, lo = sm2_mul_wide(a.v[i], a.v[i], &hi);
+        carry = sm2_adc(carry, t[2 * i], lo, &t[2 * i]);
+        carry = sm2_adc(carry, t[2 * i + 1], hi, &t[2 * i + 1]);
+    }
+}
+
+// ģ p  Montgomery Լp  -1 (mod 2^64)ÿֵ m ǵǰ֣
+// t + m*p = (t - m) + m*(p + 1)ǰʹֹ㣬߳ 2^64 Ϊ
+// m*2^192 + m - (m>>32)*2^192 - (m<<32)*2^128 - (m>>32)*2^64 - (m<<32)ֻλͼӼ
+//  i  t[i+5] ĽλӰֵ̣֮һ
+inline void sm2_fp_reduce(sm2_bn& r, uint64_t t[2 * SM2_WORDS]) {
+    unsigned char pending[SM2_WORDS];
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        uint64_t m = t[i];
+        uint64_t ml = m << 32, mh = m >> 32;
+        uint64_t u0, u1, u2, u3;
+        unsigned char c = sm2_sbb(0, m, ml, &u0);
+        c = sm2_sbb(c, 0, mh, &u1);
+        c = sm2_sbb(c, 0, ml, &u2);
+        sm2_sbb(c, m, mh, &u3);
+        c = sm2_adc(0, t[i + 1], u0, &t[i + 1]);
+        c = sm2_adc(c, t[i + 2], u1, &t[i + 2]);
+        c = sm2_adc(c, t[i + 3], u2, &t[i + 3]);
+        pending[i] = sm2_adc(c, t[i + 4], u3, &t[i + 4]);
+    }
+    unsigned char c = sm2_adc(0, t[5], pending[0], &t[5]);
+    c = sm2_adc(c, t[6], pending[1], &t[6]);
+    c = sm2_adc(c, t[7], pending[2], &t[7]);
+    sm2_bn_sub_if_ge(r, t + SM2_WORDS, static_cast<uint64_t>(c) + pending[3], SM2_FIELD.m);
+}
+
+// ģ p 㣬˷ƽΪ Montgomery ʽ
+inline void sm2_fp_mul(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    uint64_t t[2 * SM2_WORDS];
+    sm2_mul_512(t, a, b);
+    sm2_fp_reduce(r, t);
+}
+
+inline void sm2_fp_sqr(sm2_bn& r, const sm2_bn& a) {
+    uint64_t t[2 * SM2_WORDS];
+    sm2_sqr_512(t, a);
+    sm2_fp_reduce(r, t);
+}
+
+inline void sm2_fp_add(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    sm2_mod_add(SM2_FIELD, r, a, b);
+}
+
+inline void sm2_fp_sub(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    sm2_mod_sub(SM2_FIELD, r, a, b);
+}
+
+inline void sm2_fp_to_mont(sm2_bn& r, const sm2_bn& a) {
+    sm2_fp_mul(r, a, SM2_FIELD.rr);
+}
+
+inline void sm2_fp_from_mont(sm2_bn& r, const sm2_bn& a) {
+    sm2_bn one;
+    sm2_bn_set_word(one, 1);
+    sm2_fp_mul(r, a, one);
+}
+
+inline void sm2_fp_sqr_n(sm2_bn& r, const sm2_bn& a, int n) {
+    r = a;
+    for (int i = 0; i < n; ++i) {
+        sm2_fp_sqr(r, r);
+    }
+}
+
+// a^(p-2) ļӷp - 2 ӸλΪ 31110128132062101
+//  x^(2^k - 1) (k = 2, 3, 6, 12, 24, 30, 31, 32) 256 ƽ 15 γ˷
+inline void sm2_fp_inv(sm2_bn& r, const sm2_bn& a) {
+    sm2_bn x2, x3, x6, x12, x24, x30, x31, x32, acc;
+    sm2_fp_sqr(x2, a);
+    sm2_fp_mul(x2, x2, a);
+    sm2_fp_sqr(x3, x2);
+    sm2_fp_mul(x3, x3, a);
+    sm2_fp_sqr_n(x6, x3, 3);
+    sm2_fp_mul(x6, x6, x3);
+    sm2_fp_sqr_n(x12, x6, 6);
+    sm2_fp_mul(x12, x12, x6);
+    sm2_fp_sqr_n(x24, x12, 12);
+    sm2_fp_mul(x24, x24, x12);
+    sm2_fp_sqr_n(x30, x24, 6);
+    sm2_fp_mul(x30, x30, x6);
+    sm2_fp_sqr(x31, x30);
+    sm2_fp_mul(x31, x31, a);
+    sm2_fp_sqr(x32, x31);
+    sm2_fp_mul(x32, x32, a);
+
+    sm2_fp_sqr(acc, x31);
+    for (int i = 0; i < 4; ++i) {
+        sm2_fp_sqr_n(acc, acc, 32);
+        sm2_fp_mul(acc, acc, x32);
+    }
+    sm2_fp_sqr_n(acc, acc, 32);
+    sm2_fp_sqr_n(acc, acc, 32);
+    sm2_fp_mul(acc, acc, x32);
+    sm2_fp_sqr_n(acc, acc, 30);
+    sm2_fp_mul(acc, acc, x30);
+    sm2_fp_sqr_n(acc, acc, 2);
+    sm2_fp_mul(r, acc, a);
+}
+
+// p  3 (mod 4)ƽΪ a^((p+1)/4)ƽȥ a ʱ޽
+inline bool sm2_fp_sqrt(sm2_bn& r, const sm2_bn& a) {
+    const sm2_bn e = { { 0x4000000000000000ULL, 0xFFFFFFFFC0000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0x3FFFFFFFBFFFFFFFULL } };
+    sm2_bn acc = SM2_FIELD.one, check;
+    for (int i = 255; i >= 0; --i) {
+        sm2_fp_sqr(acc, acc);
+        if (sm2_bn_bit(e, i)) {
+            sm2_fp_mul(acc, acc, a);
+        }
+    }
+    sm2_fp_sqr(check, acc);
+    r = acc;
+    return sm2_bn_equal(check, a);
+}
+
+// ģ n ͨʽ˷棬ǩʱı
+inline void sm2_scalar_mul(sm2_bn& r, const sm2_bn& a, const sm2_bn& b) {
+    sm2_bn t;
+    sm2_mont_mul(SM2_ORDER, t, a, SM2_ORDER.rr);
+    sm2_mont_mul(SM2_ORDER, r, t, b);
+}
+
+inline void sm2_scalar_inv(sm2_bn& r, const sm2_bn& a) {
+    sm2_bn t;
+    sm2_to_mont(SM2_ORDER, t, a);
+    sm2_mont_inv(SM2_ORDER, t, t);
+    sm2_from_mont(SM2_ORDER, r, t);
+}
+
+// Jacobian  (X, Y, Z) ʾ (X/Z^2, Y/Z^3)Z = 0 ΪԶ㡣
+// Ϊģ p  Montgomery ʽв
+struct sm2_point {
+    sm2_bn x;
+    sm2_bn y;
+    sm2_bn z;
+};
+
+inline void sm2_point_set_infinity(sm2_point& r) {
+    sm2_bn_set_word(r.x, 0);
+    sm2_bn_set_word(r.y, 0);
+    sm2_bn_set_word(r.z, 0);
+}
+
+inline bool sm2_point_is_infinity(const sm2_point& a) {
+    return sm2_bn_is_zero(a.z);
+}
+
+// 㣬 a = -3alpha = 3(X - Z^2)(X + Z^2)
+inline void sm2_point_double(sm2_point& r, const sm2_point& a) {
+    if (sm2_point_is_infinity(a) || sm2_bn_is_zero(a.y)) {
+        sm2_point_set_infinity(r);
+        return;
+    }
+    sm2_bn delta, gamma, beta, alpha, t0, t1;
+    sm2_fp_sqr(delta, a.z);
+    sm2_fp_sqr(gamma, a.y);
+    sm2_fp_mul(beta, a.x, gamma);
+    sm2_fp_sub(t0, a.x, delta);
+    sm2_fp_add(t1, a.x, delta);
+    sm2_fp_mul(alpha, t0, t1);
+    sm2_fp_add(t0, alpha, alpha);
+    sm2_fp_add(alpha, t0, alpha);
+
+    // Z3 = (Y + Z)^2 - gamma - deltaڸ r ֮ǰ
+    sm2_fp_add(t0, a.y, a.z);
+    sm2_fp_sqr(t0, t0);
+    sm2_fp_sub(t0, t0, gamma);
+    sm2_fp_sub(r.z, t0, delta);
+
+    sm2_fp_add(beta, beta, beta);
+    sm2_fp_add(beta, beta, beta);
+    sm2_fp_sqr(t0, alpha);
+    sm2_fp_add(t1, beta, beta);
+    sm2_fp_sub(r.x, t0, t1);
+
+    sm2_fp_sub(t0, beta, r.x);
+    sm2_fp_mul(t0, alpha, t0);
+    sm2_fp_sqr(gamma, gamma);
+    sm2_fp_add(gamma, gamma, gamma);
+    sm2_fp_add(gamma, gamma, gamma);
+    sm2_fp_add(gamma, gamma, gamma);
+    sm2_fp_sub(r.y, t0, gamma);
+}
+
+// һӣadd-2007-blͬʱתΪ
+inline void sm2_point_add(sm2_point& r, const sm2_point& a, const sm2_point& b) {
+    if (sm2_point_is_infinity(a)) {
+        r = b;
+        return;
+    }
+    if (sm2_point_is_infinity(b)) {
+        r = a;
+        return;
+    }
+    sm2_bn z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+    sm2_fp_sqr(z1z1, a.z);
+    sm2_fp_sqr(z2z2, b.z);
+    sm2_fp_mul(u1, a.x, z2z2);
+    sm2_fp_mul(u2, b.x, z1z1);
+    sm2_fp_mul(s1, a.y, b.z);
+    sm2_fp_mul(s1, s1, z2z2);
+    sm2_fp_mul(s2, b.y, a.z);
+    sm2_fp_mul(s2, s2, z1z1);
+    sm2_fp_sub(h, u2, u1);
+    sm2_fp_sub(rr, s2, s1);
+    if (sm2_bn_is_zero(h)) {
+        if (sm2_bn_is_zero(rr)) {
+            sm2_point_double(r, a);
+        }
+        else {
+            sm2_point_set_infinity(r);
+        }
+        return;
+    }
+    sm2_fp_add(rr, rr, rr);
+    sm2_fp_add(i, h, h);
+    sm2_fp_sqr(i, i);
+    sm2_fp_mul(j, h, i);
+    sm2_fp_mul(v, u1, i);
+
+    // Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) * H
+    sm2_fp_add(t, a.z, b.z);
+    sm2_fp_sqr(t, t);
+    sm2_fp_sub(t, t, z1z1);
+    sm2_fp_sub(t, t, z2z2);
+    sm2_fp_mul(r.z, t, h);
+
+    sm2_fp_sqr(t, rr);
+    sm2_fp_sub(t, t, j);
+    sm2_fp_sub(t, t, v);
+    sm2_fp_sub(r.x, t, v);
+
+    sm2_fp_sub(t, v, r.x);
+    sm2_fp_mul(t, rr, t);
+    sm2_fp_mul(s1, s1, j);
+    sm2_fp_add(s1, s1, s1);
+    sm2_fp_sub(r.y, t, s1);
+}
+
+// תط꣨ͨʽֻһģ p 
+inline bool sm2_point_to_affine(const sm2_point& a, sm2_bn& x, sm2_bn& y) {
+    if (sm2_point_is_infinity(a)) {
+        return false;
+    }
+    sm2_bn zinv, zinv2, t;
+    sm2_fp_inv(zinv, a.z);
+    sm2_fp_sqr(zinv2, zinv);
+    sm2_fp_mul(t, a.x, zinv2);
+    sm2_fp_from_mont(x, t);
+    sm2_fp_mul(zinv2, zinv2, zinv);
+    sm2_fp_mul(t, a.y, zinv2);
+    sm2_fp_from_mont(y, t);
+    return true;
+}
+
+// ͨʽķ깹㣬귶Χ߷
+inline bool sm2_point_from_affine(sm2_point& r, const sm2_bn& x, const sm2_bn& y) {
+    if (sm2_bn_cmp(x, SM2_FIELD.m) >= 0 || sm2_bn_cmp(y, SM2_FIELD.m) >= 0) {
+        return false;
+    }
+    sm2_bn a, b, lhs, rhs, t;
+    sm2_fp_to_mont(r.x, x);
+    sm2_fp_to_mont(r.y, y);
+    r.z = SM2_FIELD.one;
+    sm2_bn_from_bytes(t, SM2_A);
+    sm2_fp_to_mont(a, t);
+    sm2_bn_from_bytes(t, SM2_B);
+    sm2_fp_to_mont(b, t);
+    sm2_fp_sqr(lhs, r.y);
+    sm2_fp_sqr(rhs, r.x);
+    sm2_fp_add(rhs, rhs, a);
+    sm2_fp_mul(rhs, rhs, r.x);
+    sm2_fp_add(rhs, rhs, b);
+    return sm2_bn_equal(lhs, rhs);
+}
+
+inline const sm2_point& sm2_generator() {
+    static const sm2_point g = [] {
+        sm2_bn x, y;
+        sm2_bn_from_bytes(x, SM2_GX);
+        sm2_bn_from_bytes(y, SM2_GY);
+        sm2_point p;
+        sm2_point_from_affine(p, x, y);
+        return p;
+    }();
+    return g;
+}
+
+// 㣬Ϊ Montgomery ʽռһ64ֽڻ
+struct alignas(64) sm2_affine_point {
+    sm2_bn x;
+    sm2_bn y;
+};
+
+// mask ȫ1ʱ r = aȫ0ʱ r 
+inline void sm2_bn_cmov(sm2_bn& r, const sm2_bn& a, uint64_t mask) {
+    for (int i = 0; i < SM2_WORDS; ++i) {
+        r.v[i] = (r.v[i] & ~mask) | (a.v[i] & mask);
+    }
+}
+
+inline void sm2_point_cmov(sm2_point& r, const sm2_point& a, uint64_t mask) {
+    sm2_bn_cmov(r.x, a.x, mask);
+    sm2_bn_cmov(r.y, a.y, mask);
+    sm2_bn_cmov(r.z, a.z, mask);
+}
+
+// a == b ʱȫ1룬򷵻0ȽϷ֧
+inline uint64_t sm2_equal_mask(uint64_t a, uint64_t b) {
+    uint64_t d = a ^ b;
+    return 0 - ((((d | (0 - d)) >> 63) & 1) ^ 1);
+}
+
+// Jacobian ӷ㣨madd-2007-blZ2 = 1һ4γ˷
+// a ΪԶʱֱȡ ba = b ʱתΪԶ
+inline void sm2_point_add_affine(sm2_point& r, const sm2_point& a, const sm2_affine_point& b) {
+    if (sm2_point_is_infinity(a)) {
+        r.x = b.x;
+        r.y = b.y;
+        r.z = SM2_FIELD.one;
+        return;
+    }
+    sm2_bn z1z1, u2, s2, h, hh, i, j, rr, v, t;
+    sm2_fp_sqr(z1z1, a.z);
+    sm2_fp_mul(u2, b.x, z1z1);
+    sm2_fp_mul(s2, b.y, a.z);
+    sm2_fp_mul(s2, s2, z1z1);
+    sm2_fp_sub(h, u2, a.x);
+    sm2_fp_sub(rr, s2, a.y);
+    if (sm2_bn_is_zero(h)) {
+        sm2_point q;
+        q.x = b.x;
+        q.y = b.y;
+        q.z = SM2_FIELD.one;
+        if (sm2_bn_is_zero(rr)) {
+            sm2_point_double(r, q);
+        }
+        else {
+            sm2_point_set_infinity(r);
+        }
+        return;
+    }
+    sm2_fp_add(rr, rr, rr);
+    sm2_fp_sqr(hh, h);
+    sm2_fp_add(i, hh, hh);
+    sm2_fp_add(i, i, i);
+    sm2_fp_mul(j, h, i);
+    sm2_fp_mul(v, a.x, i);
+
+    // Z3 = (Z1 + H)^2 - Z1Z1 - HH
+    sm2_fp_add(t, a.z, h);
+    sm2_fp_sqr(t, t);
+    sm2_fp_sub(t, t, z1z1);
+    sm2_fp_sub(t, t, hh);
+    sm2_bn y1j;
+    sm2_fp_mul(y1j, a.y, j);
+    r.z = t;
+
+    sm2_fp_sqr(t, rr);
+    sm2_fp_sub(t, t, j);
+    sm2_fp_sub(t, t, v);
+    sm2_fp_sub(r.x, t, v);
+
+    sm2_fp_sub(t, v, r.x);
+    sm2_fp_mul(t, rr, t);
+    sm2_fp_add(y1j, y1j, y1j);
+    sm2_fp_sub(r.y, t, y1j);
+}
+
+// Montgomery 棬count ֻһģ p 棬Ϊÿ3γ˷Զ (0, 0)
+inline void sm2_batch_to_affine(sm2_affine_point* out, const sm2_point* in, size_t count) {
+    vector<sm2_bn> prefix(count);
+    sm2_bn acc = SM2_FIELD.one;
+    for (size_t i = 0; i < count; ++i) {
+        prefix[i] = acc;
+        if (!sm2_point_is_infinity(in[i])) {
+            sm2_fp_mul(acc, acc, in[i].z);
+        }
+    }
+    sm2_bn inv;
+    sm2_fp_inv(inv, acc);
+    for (size_t i = count; i-- > 0;) {
+        if (sm2_point_is_infinity(in[i])) {
+            sm2_bn_set_word(out[i].x, 0);
+            sm2_bn_set_word(out[i].y, 0);
+            continue;
+        }
+        sm2_bn zinv, zinv2;
+        sm2_fp_mul(zinv, inv, prefix[i]);
+        sm2_fp_mul(inv, inv, in[i].z);
+        sm2_fp_sqr(zinv2, zinv);
+        sm2_fp_mul(out[i].x, in[i].x, zinv2);
+        sm2_fp_mul(zinv2, zinv2, zinv);
+        sm2_fp_mul(out[i].y, in[i].y, zinv2);
+    }
+}
+
+//  G Ķ i е j Ϊ j * 16^i * Gj = 0  16^i * G ռλȡᱻ붪
+// kG  k 644λȡӣҪ㡣 64KB״ʹʱһ
+constexpr int SM2_COMB_ROWS = 256 / SM2_WINDOW_BITS;
+
+struct sm2_comb_table {
+    sm2_affine_point points[SM2_COMB_ROWS][SM2_WINDOW_SIZE];
+};
+
+inline const sm2_comb_table& sm2_base_table() {
+    // ̬洢֤64ֽڶ룻ready ĳʼִֻһΣ״εû
+    static sm2_comb_table table;
+    static const bool ready = [] {
+        vector<sm2_point> jacobian(SM2_COMB_ROWS * SM2_WINDOW_SIZE);
+        sm2_point base = sm2_generator();
+        for (int i = 0; i < SM2_COMB_ROWS; ++i) {
+            sm2_point* row = &jacobian[i * SM2_WINDOW_SIZE];
+            row[0] = base;
+            row[1] = base;
+            for (int j = 2; j < SM2_WINDOW_SIZE; ++j) {
+                sm2_point_add(row[j], row[j - 1], base);
+            }
+            sm2_point_add(base, row[SM2_WINDOW_SIZE - 1], base);
+        }
+        sm2_batch_to_affine(&table.points[0][0], jacobian.data(), jacobian.size());
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+// ʱ16µ digit ôģʽ digit ޹
+inline void sm2_comb_select(sm2_affine_point& r, const sm2_affine_point row[SM2_WINDOW_SIZE], uint64_t digit) {
+    sm2_bn_set_word(r.x, 0);
+    sm2_bn_set_word(r.y, 0);
+    for (int j = 0; j < SM2_WINDOW_SIZE; ++j) {
+        uint64_t mask = sm2_equal_mask(static_cast<uint64_t>(j), digit);
+        for (int w = 0; w < SM2_WORDS; ++w) {
+            r.x.v[w] |= row[j].x.v[w] & mask;
+            r.y.v[w] |= row[j].y.v[w] & mask;
+        }
+    }
+}
+
+//  kG64γʱͻϵӡΪ0ʱԭֵ
+// ۼֵΪʱֱȡѡ֧
+// ۼֵΪڼӵռλ㣬б궼ͬߵӵ֧
+inline void sm2_point_mul_base(sm2_point& r, const sm2_bn& k) {
+    const sm2_comb_table& table = sm2_base_table();
+    sm2_affine_point sel;
+    sm2_point acc, sum, fresh;
+    uint64_t digit = k.v[0] & (SM2_WINDOW_SIZE - 1);
+    sm2_comb_select(sel, table.points[0], digit);
+    acc.x = sel.x;
+    acc.y = sel.y;
+    acc.z = SM2_FIELD.one;
+    uint64_t empty = sm2_equal_mask(digit, 0);
+    for (int i = 1; i < SM2_COMB_ROWS; ++i) {
+        int bit = i * SM2_WINDOW_BITS;
+        digit = (k.v[bit >> 6] >> (bit & 63)) & (SM2_WINDOW_SIZE - 1);
+        sm2_comb_select(sel, table.points[i], digit);
+        sm2_point_add_affine(sum, acc, sel);
+        fresh.x = sel.x;
+        fresh.y = sel.y;
+        fresh.z = SM2_FIELD.one;
+        uint64_t zero = sm2_equal_mask(digit, 0);
+        sm2_point_cmov(sum, acc, zero);
+        sm2_point_cmov(sum, fresh, empty & ~zero);
+        acc = sum;
+        empty &= zero;
+    }
+    sm2_point infinity;
+    sm2_point_set_infinity(infinity);
+    sm2_point_cmov(acc, infinity, empty);
+    r = acc;
+}
+
+// ʱı kPڽܵ˽Կ d ͼܵʱ kҪ k < n
+//  j Ϊ jP0 P ռλ̶64ڣÿ4α㡢һγʱͻϵӣ
+// Ϊ0ۼֵΪյ sm2_point_mul_base һѡ
+// ۼֵΪڼ䱣 16^i * P֮Ϊ k ĸλǰ׺ P k < n  jP ȣ
+// Ա͵Ӳߵִ֧· k ޹ءP ֻӰ콨ǹ߸Ĺ
+inline void sm2_point_mul_ct(sm2_point& r, const sm2_bn& k, const sm2_point& p) {
+    sm2_point jacobian[SM2_WINDOW_SIZE];
+    jacobian[0] = p;
+    jacobian[1] = p;
+    sm2_point_double(jacobian[2], p);
+    for (int j = 3; j < SM2_WINDOW_SIZE; ++j) {
+        sm2_point_add(jacobian[j], jacobian[j - 1], p);
+    }
+    sm2_affine_point table[SM2_WINDOW_SIZE];
+    sm2_batch_to_affine(table, jacobian, SM2_WINDOW_SIZE);
+
+    sm2_affine_point sel;
+    sm2_point acc, sum, fresh;
+    int bit = 256 - SM2_WINDOW_BITS;
+    uint64_t digit = (k.v[bit >> 6] >> (bit & 63)) & (SM2_WINDOW_SIZE - 1);
+    sm2_comb_select(sel, table, digit);
+    acc.x = sel.x;
+    acc.y = sel.y;
+    acc.z = SM2_FIELD.one;
+    uint64_t empty = sm2_equal_mask(digit, 0);
+    for (int i = 256 / SM2_WINDOW_BITS - 2; i >= 0; --i) {
+        for (int j = 0; j < SM2_WINDOW_BITS; ++j) {
+            sm2_point_double(acc, acc);
+        }
+        bit = i * SM2_WINDOW_BITS;
+        digit = (k.v[bit >> 6] >> (bit & 63)) & (SM2_WINDOW_SIZE - 1);
+        sm2_comb_select(sel, table, digit);
+        sm2_point_add_affine(sum, acc, sel);
+        fresh.x = sel.x;
+        fresh.y = sel.y;
+        fresh.z = SM2_FIELD.one;
+        uint64_t zero = sm2_equal_mask(digit, 0);
+        sm2_point_cmov(sum, acc, zero);
+        sm2_point_cmov(sum, fresh, empty & ~zero);
+        acc = sum;
+        empty &= zero;
+    }
+    sm2_point infinity;
+    sm2_point_set_infinity(infinity);
+    sm2_point_cmov(acc, infinity, empty);
+    r = acc;
+}
+
+// ---- ǩõıʱˣ붼ǹ ----
+
+constexpr int SM2_NAF_LENGTH = 258;
+constexpr int SM2_BASE_NAF_WIDTH = 7;
+constexpr int SM2_POINT_NAF_WIDTH = 5;
+
+inline uint64_t sm2_bn_bits(const sm2_bn& k, int pos, int count) {
+    if (pos >= 256) {
+        return 0;
+    }
+    int idx = pos >> 6, shift = pos & 63;
+    uint64_t v = k.v[idx] >> shift;
+    if (shift + count > 64 && idx + 1 < SM2_WORDS) {
+        v |= k.v[idx + 1] << (64 - shift);
+    }
+    return v & ((1ULL << count) - 1);
+}
+
+//  w  wNAF ʾΪ 1, 3, ..., (2^(w-1) - 1) w λһ㡣
+// ߷λ1
+inline int sm2_wnaf(int8_t naf[SM2_NAF_LENGTH], const sm2_bn& k, int w) {
+    memset(naf, 0, SM2_NAF_LENGTH);
+    int carry = 0, length = 0;
+    for (int bit = 0; bit < SM2_NAF_LENGTH;) {
+        if (static_cast<int>(sm2_bn_bits(k, bit, 1)) == carry) {
+            ++bit;
+            continue;
+        }
+        int now = min(w, SM2_NAF_LENGTH - bit);
+        int word = static_cast<int>(sm2_bn_bits(k, bit, now)) + carry;
+        carry = (word >> (w - 1)) & 1;
+        word -= carry << w;
+        naf[bit] = static_cast<int8_t>(word);
+        length = bit + 1;
+        bit += now;
+    }
+    return length;
+}
+
+inline void sm2_affine_neg(sm2_affine_point& r, const sm2_affine_point& a) {
+    sm2_bn zero;
+    sm2_bn_set_word(zero, 0);
+    r.x = a.x;
+    sm2_fp_sub(r.y, zero, a.y);
+}
+
+inline void sm2_point_neg(sm2_point& r, const sm2_point& a) {
+    sm2_bn zero;
+    sm2_bn_set_word(zero, 0);
+    r.x = a.x;
+    sm2_fp_sub(r.y, zero, a.y);
+    r.z = a.z;
+}
+
+// wNAF ӣdigit > 0  table[(digit-1)/2]digit < 0 为
+inline void sm2_add_naf_affine(sm2_point& acc, const sm2_affine_point* table, int digit) {
+    if (digit > 0) {
+        sm2_point_add_affine(acc, acc, table[(digit - 1) / 2]);
+    }
+    else if (digit < 0) {
+        sm2_affine_point neg;
+        sm2_affine_neg(neg, table[(-digit - 1) / 2]);
+        sm2_point_add_affine(acc, acc, neg);
+    }
+}
+
+inline void sm2_add_naf_point(sm2_point& acc, const sm2_point* table, int digit) {
+    if (digit > 0) {
+        sm2_point_add(acc, acc, table[(digit - 1) / 2]);
+    }
+    else if (digit < 0) {
+        sm2_point neg;
+        sm2_point_neg(neg, table[(-digit - 1) / 2]);
+        sm2_point_add(acc, acc, neg);
+    }
+}
+
+// P, 3P, 5P, ...  count 
+inline void sm2_odd_multiples(sm2_point* table, const sm2_point& p, int count) {
+    sm2_point twice;
+    sm2_point_double(twice, p);
+    table[0] = p;
+    for (int i = 1; i < count; ++i) {
+        sm2_point_add(table[i], table[i - 1], twice);
+    }
+}
+
+// G  G, 3G, ..., 63GwNAF 7ʽ״ʹʱ
+inline const sm2_affine_point* sm2_base_odd_multiples() {
+    constexpr int count = 1 << (SM2_BASE_NAF_WIDTH - 2);
+    static sm2_affine_point table[count];
+    static const bool ready = [] {
+        sm2_point jacobian[count];
+        sm2_odd_multiples(jacobian, sm2_generator(), count);
+        sm2_batch_to_affine(table, jacobian, count);
+        return true;
+    }();
+    (void)ready;
+    return table;
+}
+
+// Strauss-Shamir  aG + bPһ԰ wNAF ֲ
+inline void sm2_point_mul_double(sm2_point& r, const sm2_bn& a, const sm2_bn& b, const sm2_point& p) {
+    int8_t naf_a[SM2_NAF_LENGTH], naf_b[SM2_NAF_LENGTH];
+    int length = max(sm2_wnaf(naf_a, a, SM2_BASE_NAF_WIDTH), sm2_wnaf(naf_b, b, SM2_POINT_NAF_WIDTH));
+    sm2_point table[1 << (SM2_POINT_NAF_WIDTH - 2)];
+    sm2_odd_multiples(table, p, 1 << (SM2_POINT_NAF_WIDTH - 2));
+    const sm2_affine_point* base = sm2_base_odd_multiples();
+    sm2_point acc;
+    sm2_point_set_infinity(acc);
+    for (int i = length - 1; i >= 0; --i) {
+        sm2_point_double(acc, acc);
+        sm2_add_naf_affine(acc, base, naf_a[i]);
+        sm2_add_naf_point(acc, table, naf_b[i]);
+    }
+    r = acc;
+}
+
+//  sum k_i * P_i 㷨ĵӴѡ
+// ʱ Strauss  wNAFÿһñ
+// ʱ Pippenger Ͱÿ c λڰѵ㰴ַŽͰú׺ͺϲ
+inline void sm2_multi_mul_strauss(sm2_point& r, const sm2_bn* scalars, const sm2_affine_point* points, size_t count) {
+    constexpr int table_size = 1 << (SM2_POINT_NAF_WIDTH - 2);
+    vector<int8_t> nafs(count * SM2_NAF_LENGTH);
+    vector<sm2_point> jacobian(count * table_size);
+    vector<sm2_affine_point> tables(count * table_size);
+    int length = 0;
+    for (size_t i = 0; i < count; ++i) {
+        length = max(length, sm2_wnaf(&nafs[i * SM2_NAF_LENGTH], scalars[i], SM2_POINT_NAF_WIDTH));
+        sm2_point p;
+        p.x = points[i].x;
+        p.y = points[i].y;
+        p.z = SM2_FIELD.one;
+        sm2_odd_multiples(&jacobian[i * table_size], p, table_size);
+    }
+    sm2_batch_to_affine(tables.data(), jacobian.data(), jacobian.size());
+    sm2_point acc;
+    sm2_point_set_infinity(acc);
+    for (int bit = length - 1; bit >= 0; --bit) {
+        sm2_point_double(acc, acc);
+        for (size_t i = 0; i < count; ++i) {
+            sm2_add_naf_affine(acc, &tables[i * table_size], nafs[i * SM2_NAF_LENGTH + bit]);
+        }
+    }
+    r = acc;
+}
+
+inline void sm2_multi_mul_pippenger(sm2_point& r, const sm2_bn* scalars, const sm2_affine_point* points, size_t count, int c) {
+    vector<sm2_point> buckets((size_t(1) << c) - 1);
+    sm2_point acc;
+    sm2_point_set_infinity(acc);
+    for (int window = (256 + c - 1) / c - 1; window >= 0; --window) {
+        for (int i = 0; i < c; ++i) {
+            sm2_point_double(acc, acc);
+        }
+        for (sm2_point& bucket : buckets) {
+            sm2_point_set_infinity(bucket);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t digit = sm2_bn_bits(scalars[i], window * c, c);
+            if (digit != 0) {
+                sm2_point_add_affine(buckets[digit - 1], buckets[digit - 1], points[i]);
+            }
+        }
+        // sum b * bucket[b] = Ӹߵۼӵĺ׺֮
+        sm2_point running, window_sum;
+        sm2_point_set_infinity(running);
+        sm2_point_set_infinity(window_sum);
+        for (size_t b = buckets.size(); b-- > 0;) {
+            sm2_point_add(running, running, buckets[b]);
+            sm2_point_add(window_sum, window_sum, running);
+        }
+        sm2_point_add(acc, acc, window_sum);
+    }
+    r = acc;
+}
+
+inline void sm2_multi_mul(sm2_point& r, const sm2_bn* scalars, const sm2_affine_point* points, size_t count) {
+    double strauss_cost = count * (256.0 / (SM2_POINT_NAF_WIDTH + 1) + (1 << (SM2_POINT_NAF_WIDTH - 2)) + 3);
+    double best_cost = strauss_cost;
+    int best_c = 0;
+    for (int c = 2; c <= 16; ++c) {
+        double cost = ((256 + c - 1) / c) * (count + 2.0 * (1 << c));
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_c = c;
+        }
+    }
+    if (best_c == 0) {
+        sm2_multi_mul_strauss(r, scalars, points, count);
+    }
+    else {
+        sm2_multi_mul_pippenger(r, scalars, points, count, best_c);
+    }
+}
+
+// ˽Կͬʱ (1 + d)^-1 mod nǩʱ
+struct sm2_private_key {
+    sm2_bn d;
+    sm2_bn d1_inv;
+};
+
+// Կ Montgomery ʽĵ Z_AZ_A ֻ빫ԿûIDйأ
+// ùԿʱһΣ֮ÿϢ e = SM3(Z_A || M) ֻӴϢ
+struct sm2_public_key {
+    sm2_point q;
+    uint8_t xy[2 * SM2_BYTES];
+    uint8_t za[SM3_DIGEST_BYTES];
+};
+
+struct sm2_signature {
+    uint8_t r[SM2_BYTES];
+    uint8_t s[SM2_BYTES];
+};
+
+// Z_A = SM3(ENTL_A || ID_A || a || b || xG || yG || xA || yA)ENTL_A ΪIDıسȣ2ֽڴˣ
+inline void sm2_compute_za(const uint8_t xy[2 * SM2_BYTES], const uint8_t* id, size_t id_len, uint8_t za[SM3_DIGEST_BYTES]) {
+    uint16_t entl = static_cast<uint16_t>(id_len * 8);
+    uint8_t entl_bytes[2] = { static_cast<uint8_t>(entl >> 8), static_cast<uint8_t>(entl) };
+    sm3_context ctx;
+    sm3_init(ctx);
+    sm3_update(ctx, entl_bytes, 2);
+    sm3_update(ctx, id, id_len);
+    sm3_update(ctx, SM2_A, SM2_BYTES);
+    sm3_update(ctx, SM2_B, SM2_BYTES);
+    sm3_update(ctx, SM2_GX, SM2_BYTES);
+    sm3_update(ctx, SM2_GY, SM2_BYTES);
+    sm3_update(ctx, xy, 2 * SM2_BYTES);
+    sm3_final(ctx, za);
+}
+
+// 64ֽڵ x || y ùԿ Z_Aid ΪʱʹĬID
+// IDıسܷŽֽڣҲԶ
+inline bool sm2_set_public_key(sm2_public_key& pub, const uint8_t xy[2 * SM2_BYTES], const uint8_t* id = nullptr, size_t id_len = 0) {
+    if (id == nullptr) {
+        id = reinterpret_cast<const uint8_t*>(SM2_DEFAULT_ID);
+        id_len = sizeof(SM2_DEFAULT_ID) - 1;
+    }
+    if (id_len > 0x1FFF) {
+        return false;
+    }
+    sm2_bn x, y;
+    sm2_bn_from_bytes(x, xy);
+    sm2_bn_from_bytes(y, xy + SM2_BYTES);
+    if (!sm2_point_from_affine(pub.q, x, y)) {
+        return false;
+    }
+    memcpy(pub.xy, xy, sizeof(pub.xy));
+    sm2_compute_za(pub.xy, id, id_len, pub.za);
+    return true;
+}
+
+// ˽Կ d  [1, n-2] ڣ 1 + d 
+inline bool sm2_set_private_key(sm2_private_key& priv, const uint8_t d[SM2_BYTES]) {
+    const sm2_mont_ctx& n = SM2_ORDER;
+    sm2_bn_from_bytes(priv.d, d);
+    sm2_bn one, limit;
+    sm2_bn_set_word(one, 1);
+    sm2_bn_sub(limit, n.m, one);
+    if (sm2_bn_is_zero(priv.d) || sm2_bn_cmp(priv.d, limit) >= 0) {
+        return false;
+    }
+    sm2_bn t;
+    sm2_bn_add(t, priv.d, one);
+    sm2_scalar_inv(priv.d1_inv, t);
+    return true;
+}
+
+// ˽Կ㹫Կ P = dG
+inline bool sm2_derive_public_key(const sm2_private_key& priv, sm2_public_key& pub, const uint8_t* id = nullptr, size_t id_len = 0) {
+    sm2_point p;
+    sm2_point_mul_base(p, priv.d);
+    sm2_bn x, y;
+    if (!sm2_point_to_affine(p, x, y)) {
+        return false;
+    }
+    uint8_t xy[2 * SM2_BYTES];
+    sm2_bn_to_bytes(x, xy);
+    sm2_bn_to_bytes(y, xy + SM2_BYTES);
+    return sm2_set_public_key(pub, xy, id, id_len);
+}
+
+//  random_device ȡ [1, n-1] ڵΧȡ
+inline void sm2_random_scalar(sm2_bn& k) {
+    thread_local random_device rd;
+    const sm2_mont_ctx& n = SM2_ORDER;
+    do {
+        for (int i = 0; i < SM2_WORDS; ++i) {
+            k.v[i] = (static_cast<uint64_t>(rd()) << 32) | rd();
+        }
+    } while (sm2_bn_is_zero(k) || sm2_bn_cmp(k, n.m) >= 0);
+}
+
+inline bool sm2_generate_keypair(sm2_private_key& priv, sm2_public_key& pub, const uint8_t* id = nullptr, size_t id_len = 0) {
+    uint8_t d[SM2_BYTES];
+    do {
+        sm2_bn k;
+        sm2_random_scalar(k);
+        sm2_bn_to_bytes(k, d);
+    } while (!sm2_set_private_key(priv, d));
+    memset(d, 0, sizeof(d));
+    return sm2_derive_public_key(priv, pub, id, id_len);
+}
+
+// e = SM3(Z_A || M)
+inline void sm2_message_digest(const sm2_public_key& pub, const uint8_t* msg, size_t msg_len, uint8_t e[SM3_DIGEST_BYTES]) {
+    sm3_context ctx;
+    sm3_init(ctx);
+    sm3_update(ctx, pub.za, SM3_DIGEST_BYTES);
+    sm3_update(ctx, msg, msg_len);
+    sm3_final(ctx, e);
+}
+
+// ǩ k  kG ĺ꣨ģ nϢ޹أǰá
+// recovery_id  bit0 Ϊ kG żbit1 ʾ겻С nǩʱ r ָ kG
+struct sm2_nonce {
+    sm2_bn k;
+    sm2_bn x1;
+    uint8_t recovery_id;
+};
+
+inline bool sm2_nonce_from_scalar(sm2_nonce& nonce, const sm2_bn& k) {
+    sm2_point kg;
+    sm2_point_mul_base(kg, k);
+    sm2_bn x1, y1;
+    if (!sm2_point_to_affine(kg, x1, y1)) {
+        return false;
+    }
+    nonce.x1 = x1;
+    sm2_mod_reduce_once(SM2_ORDER, nonce.x1);
+    nonce.recovery_id = static_cast<uint8_t>((y1.v[0] & 1) | (sm2_bn_equal(nonce.x1, x1) ? 0 : 2));
+    nonce.k = k;
+    return true;
+}
+
+inline void sm2_generate_nonce(sm2_nonce& nonce) {
+    sm2_bn k;
+    do {
+        sm2_random_scalar(k);
+    } while (!sm2_nonce_from_scalar(nonce, k));
+    memset(&k, 0, sizeof(k));
+}
+
+// ̨Ԥĳءǩʱȡһֳɵ (k, x1)ֻ߲ʣģ n ˷
+// ؿʱ falseɵ÷ֳ㡣ȡʱе
+class sm2_nonce_pool {
+public:
+    explicit sm2_nonce_pool(size_t capacity, unsigned thread_count = 1) : capacity(capacity) {
+        nonces.reserve(capacity);
+        for (unsigned i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this] { refill(); });
+        }
+    }
+
+    sm2_nonce_pool(const sm2_nonce_pool&) = delete;
+    sm2_nonce_pool& operator=(const sm2_nonce_pool&) = delete;
+
+    ~sm2_nonce_pool() {
+        {
+            lock_guard<mutex> lock(guard);
+            stopping = true;
+        }
+        not_full.notify_all();
+        full.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (sm2_nonce& nonce : nonces) {
+            memset(&nonce, 0, sizeof(nonce));
+        }
+    }
+
+    bool take(sm2_nonce& nonce) {
+        {
+            lock_guard<mutex> lock(guard);
+            if (nonces.empty()) {
+                return false;
+            }
+            nonce = nonces.back();
+            memset(&nonces.back(), 0, sizeof(sm2_nonce));
+            nonces.pop_back();
+        }
+        not_full.notify_one();
+        return true;
+    }
+
+    size_t size() {
+        lock_guard<mutex> lock(guard);
+        return nonces.size();
+    }
+
+    // ΪֹʱԤ
+    void wait_until_full() {
+        unique_lock<mutex> lock(guard);
+        full.wait(lock, [this] { return stopping || nonces.size() >= capacity; });
+    }
+
+private:
+    void refill() {
+        for (;;) {
+            {
+                unique_lock<mutex> lock(guard);
+                not_full.wait(lock, [this] { return stopping || nonces.size() < capacity; });
+                if (stopping) {
+                    return;
+                }
+            }
+            sm2_nonce nonce;
+            sm2_generate_nonce(nonce);
+            {
+                lock_guard<mutex> lock(guard);
+                if (nonces.size() < capacity) {
+                    nonces.push_back(nonce);
+                }
+                if (nonces.size() >= capacity) {
+                    full.notify_all();
+                }
+            }
+            memset(&nonce, 0, sizeof(nonce));
+        }
+    }
+
+    size_t capacity;
+    bool stopping = false;
+    vector<sm2_nonce> nonces;
+    vector<thread> workers;
+    mutex guard;
+    condition_variable not_full;
+    condition_variable full;
+};
+
+// øժҪǩr = (e + x1) mod ns = (1 + d)^-1 (k - rd) mod n
+// r = 0r + k = n  s = 0 ʱ false軻һ
+inline bool sm2_sign_digest_with_nonce(const sm2_private_key& priv, const uint8_t e[SM3_DIGEST_BYTES], const sm2_nonce& nonce, sm2_signature& sig) {
+    const sm2_mont_ctx& n = SM2_ORDER;
+    sm2_bn r, ev, t;
+    sm2_bn_from_bytes(ev, e);
+    sm2_mod_reduce_once(n, ev);
+    sm2_mod_add(n, r, ev, nonce.x1);
+    sm2_mod_add(n, t, r, nonce.k);
+    if (sm2_bn_is_zero(r) || sm2_bn_is_zero(t)) {
+        return false;
+    }
+    sm2_bn s;
+    sm2_scalar_mul(t, r, priv.d);
+    sm2_mod_sub(n, t, nonce.k, t);
+    sm2_scalar_mul(s, priv.d1_inv, t);
+    if (sm2_bn_is_zero(s)) {
+        return false;
+    }
+    sm2_bn_to_bytes(r, sig.r);
+    sm2_bn_to_bytes(s, sig.s);
+    return true;
+}
+
+// ʱȴӳȡؿֳɡrecovery_id ǿʱָʶ
+inline bool sm2_sign_digest(const sm2_private_key& priv, const uint8_t e[SM3_DIGEST_BYTES], sm2_signature& sig, sm2_nonce_pool* pool = nullptr,
+    uint8_t* recovery_id = nullptr) {
+    sm2_nonce nonce;
+    do {
+        if (pool == nullptr || !pool->take(nonce)) {
+            sm2_generate_nonce(nonce);
+        }
+    } while (!sm2_sign_digest_with_nonce(priv, e, nonce, sig));
+    if (recovery_id != nullptr) {
+        *recovery_id = nonce.recovery_id;
+    }
+    memset(&nonce, 0, sizeof(nonce));
+    return true;
+}
+
+inline bool sm2_sign(const sm2_private_key& priv, const sm2_public_key& pub, const uint8_t* msg, size_t msg_len, sm2_signature& sig,
+    sm2_nonce_pool* pool = nullptr, uint8_t* recovery_id = nullptr) {
+    uint8_t e[SM3_DIGEST_BYTES];
+    sm2_message_digest(pub, msg, msg_len, e);
+    return sm2_sign_digest(priv, e, sig, pool, recovery_id);
+}
+
+// ǩ rs  [1, n-1]  t = (r + s) mod n  0
+inline bool sm2_signature_scalars(const sm2_signature& sig, sm2_bn& r, sm2_bn& s, sm2_bn& t) {
+    const sm2_mont_ctx& n = SM2_ORDER;
+    sm2_bn_from_bytes(r, sig.r);
+    sm2_bn_from_bytes(s, sig.s);
+    if (sm2_bn_is_zero(r) || sm2_bn_cmp(r, n.m) >= 0 || sm2_bn_is_zero(s) || sm2_bn_cmp(s, n.m) >= 0) {
+        return false;
+    }
+    sm2_mod_add(n, t, r, s);
+    return !sm2_bn_is_zero(t);
+}
+
+// ǩt = (r + s) mod n(x1, y1) = sG + tP (e + x1) mod n == r
+// sG + tP  Strauss-Shamir 㣬ֻһ
+inline bool sm2_verify_digest(const sm2_public_key& pub, const uint8_t e[SM3_DIGEST_BYTES], const sm2_signature& sig) {
+    const sm2_mont_ctx& n = SM2_ORDER;
+    sm2_bn r, s, t;
+    if (!sm2_signature_scalars(sig, r, s, t)) {
+        return false;
+    }
+    sm2_point sum;
+    sm2_point_mul_double(sum, s, t, pub.q);
+    sm2_bn x1, y1, ev, rr;
+    if (!sm2_point_to_affine(sum, x1, y1)) {
+        return false;
+    }
+    sm2_bn_from_bytes(ev, e);
+    sm2_mod_reduce_once(n, ev);
+    sm2_mod_reduce_once(n, x1);
+    sm2_mod_add(n, rr, ev, x1);
+    return sm2_bn_equal(rr, r);
+}
+
+inline bool sm2_verify(const sm2_public_key& pub, const uint8_t* msg, size_t msg_len, const sm2_signature& sig) {
+    uint8_t e[SM3_DIGEST_BYTES];
+    sm2_message_digest(pub, msg, msg_len, e);
+    return sm2_verify_digest(pub, e, sig);
+}
+
+// ǩһrecovery_id ΪǩʱһĻָʶδ֪ʱ -1Ϊǩ
+struct sm2_batch_item {
+    const sm2_public_key* pub;
+    uint8_t e[SM3_DIGEST_BYTES];
+    sm2_signature sig;
+    int recovery_id;
+};
+
+// Ԥһ st  r ָĵ R = kG
+struct sm2_batch_entry {
+    size_t index;
+    const sm2_public_key* pub;
+    sm2_bn s;
+    sm2_bn t;
+    sm2_affine_point point;
+};
+
+// Сڴ鲻ϼ飬ֱǩ
+constexpr size_t SM2_BATCH_MIN_GROUP = 8;
+
+//  r  e ָ Rx1 = (r - e) mod nbit1 λʱټ ny1 ȡ bit0 żͬƽ
+inline bool sm2_recover_point(sm2_affine_point& point, const sm2_bn& r, const uint8_t e[SM3_DIGEST_BYTES], int recovery_id) {
+    sm2_bn ev, x, y, rhs, t;
+    sm2_bn_from_bytes(ev, e);
+    sm2_mod_reduce_once(SM2_ORDER, ev);
+    sm2_mod_sub(SM2_ORDER, x, r, ev);
+    if (recovery_id & 2) {
+        if (sm2_bn_add(x, x, SM2_ORDER.m) || sm2_bn_cmp(x, SM2_FIELD.m) >= 0) {
+            return false;
+        }
+    }
+    sm2_fp_to_mont(point.x, x);
+    sm2_bn_from_bytes(t, SM2_A);
+    sm2_fp_to_mont(rhs, t);
+    sm2_fp_sqr(t, point.x);
+    sm2_fp_add(t, t, rhs);
+    sm2_fp_mul(t, t, point.x);
+    sm2_bn_from_bytes(rhs, SM2_B);
+    sm2_fp_to_mont(rhs, rhs);
+    sm2_fp_add(rhs, t, rhs);
+    if (!sm2_fp_sqrt(point.y, rhs)) {
+        return false;
+    }
+    sm2_fp_from_mont(y, point.y);
+    if (static_cast<int>(y.v[0] & 1) != (recovery_id & 1)) {
+        sm2_bn zero;
+        sm2_bn_set_word(zero, 0);
+        sm2_fp_sub(point.y, zero, point.y);
+    }
+    return true;
+}
+
+// ϼ飺ȡ128λ z_i (sum z_i s_i) G + sum (z_i t_i) P_i - sum z_i R_i ǷΪԶ㡣
+// ͬһԿϵȺϲˡЧǩʱʽĸԼΪ 2^-128
+inline bool sm2_batch_check(const sm2_batch_entry* entries, size_t count) {
+    thread_local random_device rd;
+    const sm2_mont_ctx& n = SM2_ORDER;
+    sm2_bn g_scalar;
+    sm2_bn_set_word(g_scalar, 0);
+    vector<sm2_bn> scalars;
+    vector<sm2_affine_point> points;
+    scalars.reserve(2 * count);
+    points.reserve(2 * count);
+    unordered_map<const sm2_public_key*, size_t> key_slots;
+    for (size_t i = 0; i < count; ++i) {
+        const sm2_batch_entry& entry = entries[i];
+        sm2_bn z, product;
+        do {
+            z.v[0] = (static_cast<uint64_t>(rd()) << 32) | rd();
+            z.v[1] = (static_cast<uint64_t>(rd()) << 32) | rd();
+            z.v[2] = 0;
+            z.v[3] = 0;
+        } while (sm2_bn_is_zero(z));
+        sm2_scalar_mul(product, z, entry.s);
+        sm2_mod_add(n, g_scalar, g_scalar, product);
+
+        sm2_scalar_mul(product, z, entry.t);
+        auto slot = key_slots.find(entry.pub);
+        if (slot != key_slots.end()) {
+            sm2_mod_add(n, scalars[slot->second], scalars[slot->second], product);
+        }
+        else {
+            key_slots[entry.pub] = scalars.size();
+            sm2_affine_point p;
+            p.x = entry.pub->q.x;
+            p.y = entry.pub->q.y;
+            scalars.push_back(product);
+            points.push_back(p);
+        }
+
+        sm2_affine_point negated;
+        sm2_affine_neg(negated, entry.point);
+        scalars.push_back(z);
+        points.push_back(negated);
+    }
+    sm2_point sum, g_part;
+    sm2_multi_mul(sum, scalars.data(), points.data(), scalars.size());
+    sm2_point_mul_base(g_part, g_scalar);
+    sm2_point_add(sum, sum, g_part);
+    return sm2_point_is_infinity(sum);
+}
+
+// ϼʧʱֶλֱ¼飬㹻Сǩ
+inline void sm2_batch_locate(const sm2_batch_entry* entries, size_t count, const vector<sm2_batch_item>& items, vector<uint8_t>& valid) {
+    if (count <= SM2_BATCH_MIN_GROUP) {
+        for (size_t i = 0; i < count; ++i) {
+            const sm2_batch_item& item = items[entries[i].index];
+            valid[entries[i].index] = sm2_verify_digest(*item.pub, item.e, item.sig) ? 1 : 0;
+        }
+        return;
+    }
+    if (sm2_batch_check(entries, count)) {
+        for (size_t i = 0; i < count; ++i) {
+            valid[entries[i].index] = 1;
+        }
+        return;
+    }
+    size_t half = count / 2;
+    sm2_batch_locate(entries, half, items, valid);
+    sm2_batch_locate(entries + half, count - half, items, valid);
+}
+
+// ǩvalid[i] Ϊ i Ľͨĸ
+// ָʶһϼ飬ȫЧʱֻһζˣͨʱҳЧǩ
+// ָʶȱʧΪǩֻȡǩ
+inline size_t sm2_batch_verify(const vector<sm2_batch_item>& items, vector<uint8_t>& valid) {
+    valid.assign(items.size(), 0);
+    vector<sm2_batch_entry> entries;
+    entries.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        const sm2_batch_item& item = items[i];
+        if (item.recovery_id < 0) {
+            valid[i] = sm2_verify_digest(*item.pub, item.e, item.sig) ? 1 : 0;
+            continue;
+        }
+        sm2_batch_entry entry;
+        sm2_bn r;
+        entry.index = i;
+        entry.pub = item.pub;
+        if (!sm2_signature_scalars(item.sig, r, entry.s, entry.t)) {
+            continue;
+        }
+        // ָʶֻǲŵʾָʱǩ֤ܾݴΪЧ
+        if (sm2_recover_point(entry.point, r, item.e, item.recovery_id)) {
+            entries.push_back(entry);
+        }
+        else {
+            valid[i] = sm2_verify_digest(*item.pub, item.e, item.sig) ? 1 : 0;
+        }
+    }
+    sm2_batch_locate(entries.data(), entries.size(), items, valid);
+    size_t passed = 0;
+    for (uint8_t v : valid) {
+        passed += v;
+    }
+    return passed;
+}
+
+// ---- Կܣĸʽ C1 || C3 || C2 ----
+// C1 = kG Ϊ 04 || x1 || y1C3 = SM3(x2 || M || y2)C2 = M  KDF(x2 || y2, klen) (x2, y2) = kP
+constexpr size_t SM2_C1_SIZE = 1 + 2 * SM2_BYTES;
+constexpr size_t SM2_CIPHER_OVERHEAD = SM2_C1_SIZE + SM3_DIGEST_BYTES;
+
+// ÿ߳ٷֵKDFϢڵǰ߳ɣ̴߳
+constexpr size_t SM2_KDF_MIN_BLOCKS_PER_THREAD = 1 << 11;
+
+// ʽKDF ct Ϊ SM3(x2 || y2 || ct)ct 1ʼΪ32λˡ
+// x2 || y2 ǡһSM3飬ѹһκ󱣴״̬˺ÿֻѹһ̶ʽĩβ顣
+// 黥ݰֱָ̣߳ϣԿ
+struct sm2_kdf_stream {
+    uint32_t state[8];
+    uint32_t counter;
+    uint8_t block[SM3_DIGEST_BYTES];
+    size_t block_used;
+    uint8_t nonzero;
+    unsigned thread_count;
+};
+
+inline void sm2_kdf_init(sm2_kdf_stream& kdf, const uint8_t z[2 * SM2_BYTES], unsigned thread_count) {
+    memcpy(kdf.state, IV, sizeof(IV));
+    sm3_compress(kdf.state, z);
+    kdf.counter = 1;
+    kdf.block_used = SM3_DIGEST_BYTES;
+    kdf.nonzero = 0;
+    kdf.thread_count = thread_count == 0 ? 1 : thread_count;
+}
+
+// ĩβΪ ct || 0x80 || 0 ... || Ϣس (64 + 4) * 8
+inline void sm2_kdf_block(const uint32_t state[8], uint32_t ct, uint8_t out[SM3_DIGEST_BYTES]) {
+    uint8_t block[SM3_BLOCK_BYTES] = { 0 };
+    block[0] = static_cast<uint8_t>(ct >> 24);
+    block[1] = static_cast<uint8_t>(ct >> 16);
+    block[2] = static_cast<uint8_t>(ct >> 8);
+    block[3] = static_cast<uint8_t>(ct);
+    block[4] = 0x80;
+    constexpr uint32_t bit_length = (SM3_BLOCK_BYTES + 4) * 8;
+    block[SM3_BLOCK_BYTES - 2] = static_cast<uint8_t>(bit_length >> 8);
+    block[SM3_BLOCK_BYTES - 1] = static_cast<uint8_t>(bit_length);
+    uint32_t s[8];
+    memcpy(s, state, sizeof(s));
+    sm3_compress(s, block);
+    for (int i = 0; i < 8; ++i) {
+        out[i * 4] = static_cast<uint8_t>(s[i] >> 24);
+        out[i * 4 + 1] = static_cast<uint8_t>(s[i] >> 16);
+        out[i * 4 + 2] = static_cast<uint8_t>(s[i] >> 8);
+        out[i * 4 + 3] = static_cast<uint8_t>(s[i]);
+    }
+    memset(s, 0, sizeof(s));
+}
+
+// ü first_ct  count  count * 32 ֽڣԿֽڵĻ
+inline uint8_t sm2_kdf_xor_blocks(const uint32_t state[8], uint32_t first_ct, const uint8_t* in, uint8_t* out, size_t count) {
+    uint8_t key[SM3_DIGEST_BYTES];
+    uint8_t nonzero = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sm2_kdf_block(state, static_cast<uint32_t>(first_ct + i), key);
+        for (int j = 0; j < SM3_DIGEST_BYTES; ++j) {
+            nonzero |= key[j];
+            out[j] = in[j] ^ key[j];
+        }
+        in += SM3_DIGEST_BYTES;
+        out += SM3_DIGEST_BYTES;
+    }
+    memset(key, 0, sizeof(key));
+    return nonzero;
+}
+
+// out = in   len ֽԿin  out ͬ
+// Կܳܳ (2^32 - 1) 飬ʱ false
+inline bool sm2_kdf_xor(sm2_kdf_stream& kdf, const uint8_t* in, uint8_t* out, size_t len) {
+    uint64_t available = (static_cast<uint64_t>(UINT32_MAX) - kdf.counter + 1) * SM3_DIGEST_BYTES + (SM3_DIGEST_BYTES - kdf.block_used);
+    if (len > available) {
+        return false;
+    }
+    for (; len > 0 && kdf.block_used < SM3_DIGEST_BYTES; --len) {
+        uint8_t key = kdf.block[kdf.block_used++];
+        kdf.nonzero |= key;
+        *out++ = *in++ ^ key;
+    }
+    size_t blocks = len / SM3_DIGEST_BYTES;
+    if (blocks > 0) {
+        size_t threads = min<size_t>(kdf.thread_count, max<size_t>(1, blocks / SM2_KDF_MIN_BLOCKS_PER_THREAD));
+        size_t per_thread = (blocks + threads - 1) / threads;
+        vector<thread> workers;
+        vector<uint8_t> nonzero(threads, 0);
+        for (size_t t = 1; t < threads; ++t) {
+            size_t first = t * per_thread;
+            size_t count = min(per_thread, blocks - first);
+            workers.emplace_back([&kdf, &nonzero, in, out, first, count, t] {
+                nonzero[t] = sm2_kdf_xor_blocks(kdf.state, static_cast<uint32_t>(kdf.counter + first),
+                    in + first * SM3_DIGEST_BYTES, out + first * SM3_DIGEST_BYTES, count);
+            });
+        }
+        nonzero[0] = sm2_kdf_xor_blocks(kdf.state, kdf.counter, in, out, min(per_thread, blocks));
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+        for (uint8_t v : nonzero) {
+            kdf.nonzero |= v;
+        }
+        kdf.counter += static_cast<uint32_t>(blocks);
+        in += blocks * SM3_DIGEST_BYTES;
+        out += blocks * SM3_DIGEST_BYTES;
+        len -= blocks * SM3_DIGEST_BYTES;
+    }
+    if (len > 0) {
+        sm2_kdf_block(kdf.state, kdf.counter++, kdf.block);
+        kdf.block_used = 0;
+        for (; len > 0; --len) {
+            uint8_t key = kdf.block[kdf.block_used++];
+            kdf.nonzero |= key;
+            *out++ = *in++ ^ key;
+        }
+    }
+    return true;
+}
+
+// ܺͽܹõʽ״̬KDFC3 ӴĺҪյ y2
+struct sm2_cipher_context {
+    sm2_kdf_stream kdf;
+    sm3_context c3;
+    uint8_t y2[SM2_BYTES];
+    uint64_t remaining;
+};
+
+//  (x2, y2) ʼKDF C3C3  x2
+inline void sm2_cipher_start(sm2_cipher_context& ctx, const sm2_point& shared, unsigned thread_count) {
+    sm2_bn x2, y2;
+    sm2_point_to_affine(shared, x2, y2);
+    uint8_t z[2 * SM2_BYTES];
+    sm2_bn_to_bytes(x2, z);
+    sm2_bn_to_bytes(y2, z + SM2_BYTES);
+    sm2_kdf_init(ctx.kdf, z, thread_count);
+    sm3_init(ctx.c3);
+    sm3_update(ctx.c3, z, SM2_BYTES);
+    memcpy(ctx.y2, z + SM2_BYTES, SM2_BYTES);
+    memset(z, 0, sizeof(z));
+    memset(&x2, 0, sizeof(x2));
+    memset(&y2, 0, sizeof(y2));
+}
+
+inline void sm2_cipher_wipe(sm2_cipher_context& ctx) {
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+// ʽܡʼʱܳ msg_len׼Ҫ t = KDF(x2 || y2, klen) ȫʱ k 
+// ڵһǰ min(klen, 32) ֽȫʱȡ kklen 32ֽʱ׼һ£ʱֻȡ©С
+// ֶ֮ε sm2_encrypt_update  C2 sm2_encrypt_final  C3
+// C3 λ C2 ֮ǰдļʱλã
+inline bool sm2_encrypt_init(sm2_cipher_context& ctx, const sm2_public_key& pub, uint64_t msg_len, uint8_t c1[SM2_C1_SIZE],
+    unsigned thread_count = thread::hardware_concurrency()) {
+    if (msg_len == 0) {
+        return false;
+    }
+    size_t check = static_cast<size_t>(min<uint64_t>(msg_len, SM3_DIGEST_BYTES));
+    for (;;) {
+        sm2_bn k;
+        sm2_random_scalar(k);
+        sm2_point kg, shared;
+        sm2_point_mul_base(kg, k);
+        sm2_point_mul_ct(shared, k, pub.q);
+        memset(&k, 0, sizeof(k));
+        sm2_bn x1, y1;
+        if (!sm2_point_to_affine(kg, x1, y1) || sm2_point_is_infinity(shared)) {
+            continue;
+        }
+        sm2_cipher_start(ctx, shared, thread_count);
+        sm2_kdf_block(ctx.kdf.state, ctx.kdf.counter++, ctx.kdf.block);
+        ctx.kdf.block_used = 0;
+        uint8_t nonzero = 0;
+        for (size_t i = 0; i < check; ++i) {
+            nonzero |= ctx.kdf.block[i];
+        }
+        if (nonzero == 0) {
+            continue;
+        }
+        c1[0] = 0x04;
+        sm2_bn_to_bytes(x1, c1 + 1);
+        sm2_bn_to_bytes(y1, c1 + 1 + SM2_BYTES);
+        ctx.remaining = msg_len;
+        return true;
+    }
+}
+
+// һģout  msg ͬܳʼʱĳʱ false
+inline bool sm2_encrypt_update(sm2_cipher_context& ctx, const uint8_t* msg, size_t msg_len, uint8_t* out) {
+    if (msg_len > ctx.remaining) {
+        return false;
+    }
+    ctx.remaining -= msg_len;
+    sm3_update(ctx.c3, msg, msg_len);
+    return sm2_kdf_xor(ctx.kdf, msg, out, msg_len);
+}
+
+//  C3 ģûȫʱ false
+inline bool sm2_encrypt_final(sm2_cipher_context& ctx, uint8_t c3[SM3_DIGEST_BYTES]) {
+    bool complete = ctx.remaining == 0;
+    sm3_update(ctx.c3, ctx.y2, SM2_BYTES);
+    sm3_final(ctx.c3, c3);
+    sm2_cipher_wipe(ctx);
+    return complete;
+}
+
+// һԼܣout Ϊ C1 || C3 || C2Ϊĳȼ SM2_CIPHER_OVERHEAD
+inline bool sm2_encrypt(const sm2_public_key& pub, const uint8_t* msg, size_t msg_len, vector<uint8_t>& out,
+    unsigned thread_count = thread::hardware_concurrency()) {
+    out.assign(SM2_CIPHER_OVERHEAD + msg_len, 0);
+    sm2_cipher_context ctx;
+    if (!sm2_encrypt_init(ctx, pub, msg_len, out.data(), thread_count)) {
+        out.clear();
+        return false;
+    }
+    sm2_encrypt_update(ctx, msg, msg_len, out.data() + SM2_CIPHER_OVERHEAD);
+    return sm2_encrypt_final(ctx, out.data() + SM2_C1_SIZE);
+}
+
+// ʽܡ C1 Ϻóʱ˼ (x2, y2) = dC1
+// sm2_decrypt_update  sm2_decrypt_final ˶ C3 ֮ͨǰţ÷Ӧдʱλ
+inline bool sm2_decrypt_init(sm2_cipher_context& ctx, const sm2_private_key& priv, const uint8_t c1[SM2_C1_SIZE], uint64_t msg_len,
+    unsigned thread_count = thread::hardware_concurrency()) {
+    if (c1[0] != 0x04 || msg_len == 0) {
+        return false;
+    }
+    sm2_bn x1, y1;
+    sm2_bn_from_bytes(x1, c1 + 1);
+    sm2_bn_from_bytes(y1, c1 + 1 + SM2_BYTES);
+    sm2_point point, shared;
+    if (!sm2_point_from_affine(point, x1, y1)) {
+        return false;
+    }
+    sm2_point_mul_ct(shared, priv.d, point);
+    if (sm2_point_is_infinity(shared)) {
+        return false;
+    }
+    sm2_cipher_start(ctx, shared, thread_count);
+    ctx.remaining = msg_len;
+    return true;
+}
+
+inline bool sm2_decrypt_update(sm2_cipher_context& ctx, const uint8_t* c2, size_t c2_len, uint8_t* out) {
+    if (c2_len > ctx.remaining || !sm2_kdf_xor(ctx.kdf, c2, out, c2_len)) {
+        return false;
+    }
+    ctx.remaining -= c2_len;
+    sm3_update(ctx.c3, out, c2_len);
+    return true;
+}
+
+// ˶ C3 ġûȫ롢Կȫ C3 ʱ false
+inline bool sm2_decrypt_final(sm2_cipher_context& ctx, const uint8_t c3[SM3_DIGEST_BYTES]) {
+    bool complete = ctx.remaining == 0 && ctx.kdf.nonzero != 0;
+    uint8_t digest[SM3_DIGEST_BYTES];
+    sm3_update(ctx.c3, ctx.y2, SM2_BYTES);
+    sm3_final(ctx.c3, digest);
+    sm2_cipher_wipe(ctx);
+    uint8_t diff = 0;
+    for (int i = 0; i < SM3_DIGEST_BYTES; ++i) {
+        diff |= digest[i] ^ c3[i];
+    }
+    return complete && diff == 0;
+}
+
+// һԽ C1 || C3 || C2ʧʱ out
+inline bool sm2_decrypt(const sm2_private_key& priv, const uint8_t* cipher, size_t cipher_len, vector<uint8_t>& out,
+    unsigned thread_count = thread::hardware_concurrency()) {
+    out.clear();
+    if (cipher_len <= SM2_CIPHER_OVERHEAD) {
+        return false;
+    }
+    size_t msg_len = cipher_len - SM2_CIPHER_OVERHEAD;
+    sm2_cipher_context ctx;
+    if (!sm2_decrypt_init(ctx, priv, cipher, msg_len, thread_count)) {
+        return false;
+    }
+    out.resize(msg_len);
+    sm2_decrypt_update(ctx, cipher + SM2_CIPHER_OVERHEAD, msg_len, out.data());
+    if (!sm2_decrypt_final(ctx, cipher + SM2_C1_SIZE)) {
+        memset(out.data(), 0, out.size());
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+#endif
\ No newline at end of file
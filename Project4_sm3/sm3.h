@@ -0,0 +1,210 @@
+#ifndef SM3_H
+#define SM3_H
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+// GB/T 32905 SM3 Ӵ㷨ժҪֽΪλ merkle.h  SM3_BLOCK_BYTES/SM3_DIGEST_BYTES ͬ壻
+// е SM3_BLOCK_SIZE/SM3_DIGEST_SIZE ԱΪλﲻ
+constexpr int SM3_BLOCK_BYTES = 64;
+constexpr int SM3_DIGEST_BYTES = 32;
+constexpr int SM3_ROUNDS = 64;
+
+const uint32_t IV[8] = {
+    0x7380166F,
+    0x4914B2B9,
+    0x172442D7,
+    0xDA8A0600,
+    0xA96F30BC,
+    0x163138AA,
+    0xE38DEE4D,
+    0xB0FB0E4E
+};
+
+inline uint32_t left_rotate(uint32_t value, int shift) {
+    shift &= 31;
+    return (value << shift) | (value >> ((32 - shift) & 31));
+}
+
+inline uint32_t P0(uint32_t x) {
+    return x ^ left_rotate(x, 9) ^ left_rotate(x, 17);
+}
+
+inline uint32_t P1(uint32_t x) {
+    return x ^ left_rotate(x, 15) ^ left_rotate(x, 23);
+}
+
+// ǰ16Ϊֱ֮Ϊѡ
+inline uint32_t FF(uint32_t x, uint32_t y, uint32_t z, int j) {
+    return j < 16 ? x ^ y ^ z : (x & y) | (x & z) | (y & z);
+}
+
+inline uint32_t GG(uint32_t x, uint32_t y, uint32_t z, int j) {
+    return j < 16 ? x ^ y ^ z : (x & y) | ((~x) & z);
+}
+
+// ѹһ64ֽڵķ8ֵ״̬
+inline void sm3_compress(uint32_t state[8], const uint8_t block[SM3_BLOCK_BYTES]) {
+    uint32_t W[68];
+    uint32_t W1[64];
+    for (int j = 0; j < 16; ++j) {
+        W[j] = (static_cast<uint32_t>(block[4 * j]) << 24) |
+            (static_cast<uint32_t>(block[4 * j + 1]) << 16) |
+            (static_cast<uint32_t>(block[4 * j + 2]) << 8) |
+            static_cast<uint32_t>(block[4 * j + 3]);
+    }
+    for (int j = 16; j < 68; ++j) {
+        W[j] = P1(W[j - 16] ^ W[j - 9] ^ left_rotate(W[j - 3], 15)) ^ left_rotate(W[j - 13], 7) ^ W[j - 6];
+    }
+    for (int j = 0; j < 64; ++j) {
+        W1[j] = W[j] ^ W[j + 4];
+    }
+
+    uint32_t A = state[0];
+    uint32_t B = state[1];
+    uint32_t C = state[2];
+    uint32_t D = state[3];
+    uint32_t E = state[4];
+    uint32_t F = state[5];
+    uint32_t G = state[6];
+    uint32_t H = state[7];
+
+    for (int j = 0; j < SM3_ROUNDS; ++j) {
+        uint32_t T = j < 16 ? 0x79CC4519 : 0x7A879D8A;
+        uint32_t SS1 = left_rotate(left_rotate(A, 12) + E + left_rotate(T, j), 7);
+        uint32_t SS2 = SS1 ^ left_rotate(A, 12);
+        uint32_t TT1 = FF(A, B, C, j) + D + SS2 + W1[j];
+        uint32_t TT2 = GG(E, F, G, j) + H + SS1 + W[j];
+        D = C;
+        C = left_rotate(B, 9);
+        B = A;
+        A = TT1;
+        H = G;
+        G = left_rotate(F, 19);
+        F = E;
+        E = P0(TT2);
+    }
+
+    state[0] ^= A;
+    state[1] ^= B;
+    state[2] ^= C;
+    state[3] ^= D;
+    state[4] ^= E;
+    state[5] ^= F;
+    state[6] ^= G;
+    state[7] ^= H;
+}
+
+// ģԷֶϢڴռϢ޹
+struct sm3_context {
+    uint32_t state[8];
+    uint8_t buffer[SM3_BLOCK_BYTES];
+    size_t buffer_len;
+    uint64_t total_len;
+};
+
+inline void sm3_init(sm3_context& ctx) {
+    memcpy(ctx.state, IV, sizeof(IV));
+    ctx.buffer_len = 0;
+    ctx.total_len = 0;
+}
+
+inline void sm3_update(sm3_context& ctx, const uint8_t* msg, size_t msg_len) {
+    ctx.total_len += msg_len;
+    if (ctx.buffer_len > 0) {
+        size_t take = min(msg_len, SM3_BLOCK_BYTES - ctx.buffer_len);
+        memcpy(ctx.buffer + ctx.buffer_len, msg, take);
+        ctx.buffer_len += take;
+        msg += take;
+        msg_len -= take;
+        if (ctx.buffer_len < SM3_BLOCK_BYTES) {
+            return;
+        }
+        sm3_compress(ctx.state, ctx.buffer);
+        ctx.buffer_len = 0;
+    }
+    for (; msg_len >= SM3_BLOCK_BYTES; msg += SM3_BLOCK_BYTES, msg_len -= SM3_BLOCK_BYTES) {
+        sm3_compress(ctx.state, msg);
+    }
+    memcpy(ctx.buffer, msg, msg_len);
+    ctx.buffer_len = msg_len;
+}
+
+// 䣺׷ 0x800ĵ56ֽڣ8ֽΪ˵Ϣس
+inline void sm3_final(sm3_context& ctx, uint8_t digest[SM3_DIGEST_BYTES]) {
+    uint64_t bit_length = ctx.total_len * 8;
+    ctx.buffer[ctx.buffer_len++] = 0x80;
+    if (ctx.buffer_len > SM3_BLOCK_BYTES - 8) {
+        memset(ctx.buffer + ctx.buffer_len, 0, SM3_BLOCK_BYTES - ctx.buffer_len);
+        sm3_compress(ctx.state, ctx.buffer);
+        ctx.buffer_len = 0;
+    }
+    memset(ctx.buffer + ctx.buffer_len, 0, SM3_BLOCK_BYTES - 8 - ctx.buffer_len);
+    for (int i = 0; i < 8; ++i) {
+        ctx.buffer[SM3_BLOCK_BYTES - 1 - i] = static_cast<uint8_t>(bit_length >> (8 * i));
+    }
+    sm3_compress(ctx.state, ctx.buffer);
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = (ctx.state[i] >> 24) & 0xFF;
+        digest[i * 4 + 1] = (ctx.state[i] >> 16) & 0xFF;
+        digest[i * 4 + 2] = (ctx.state[i] >> 8) & 0xFF;
+        digest[i * 4 + 3] = ctx.state[i] & 0xFF;
+    }
+}
+
+inline void sm3_hash(const uint8_t* msg, size_t msg_len, vector<uint8_t>& hash_output) {
+    sm3_context ctx;
+    sm3_init(ctx);
+    sm3_update(ctx, msg, msg_len);
+    hash_output.resize(SM3_DIGEST_BYTES);
+    sm3_final(ctx, hash_output.data());
+}
+
+// HMAC-SM3 Կ״ֱ̬ Kipad  Kopad һ顣
+// ͬһԿ¼ϢHMACʱֻ踴ģÿϢֻʣѹ
+struct hmac_sm3_key {
+    sm3_context inner;
+    sm3_context outer;
+};
+
+inline void hmac_sm3_init(hmac_sm3_key& hkey, const uint8_t* key, size_t key_len) {
+    uint8_t block[SM3_BLOCK_BYTES] = { 0 };
+    if (key_len > SM3_BLOCK_BYTES) {
+        sm3_context ctx;
+        sm3_init(ctx);
+        sm3_update(ctx, key, key_len);
+        sm3_final(ctx, block);
+    }
+    else {
+        memcpy(block, key, key_len);
+    }
+    uint8_t pad[SM3_BLOCK_BYTES];
+    for (int i = 0; i < SM3_BLOCK_BYTES; ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    sm3_init(hkey.inner);
+    sm3_update(hkey.inner, pad, SM3_BLOCK_BYTES);
+    for (int i = 0; i < SM3_BLOCK_BYTES; ++i) {
+        pad[i] = block[i] ^ 0x5C;
+    }
+    sm3_init(hkey.outer);
+    sm3_update(hkey.outer, pad, SM3_BLOCK_BYTES);
+    memset(block, 0, sizeof(block));
+    memset(pad, 0, sizeof(pad));
+}
+
+inline void hmac_sm3(const hmac_sm3_key& hkey, const uint8_t* msg, size_t msg_len, uint8_t mac[SM3_DIGEST_BYTES]) {
+    sm3_context ctx = hkey.inner;
+    sm3_update(ctx, msg, msg_len);
+    uint8_t inner_digest[SM3_DIGEST_BYTES];
+    sm3_final(ctx, inner_digest);
+    ctx = hkey.outer;
+    sm3_update(ctx, inner_digest, SM3_DIGEST_BYTES);
+    sm3_final(ctx, mac);
+}
+
+#endif
\ No newline at end of file
@@ -6,148 +6,221 @@
 #include <random>
 #include <iomanip>
 #include <chrono>
+#include "sm3.h"
+#include "sm2.h"
 
 using namespace std;
 
-constexpr int SM3_BLOCK_SIZE = 512;
-constexpr int SM3_DIGEST_SIZE = 256;
-constexpr int SM3_ROUNDS = 64;
-
-const uint32_t IV[8] = {
-    0x7380166F,
-    0x4914B2B9,
-    0x172442D7,
-    0xDA8A0600,
-    0xA96F30BC,
-    0x163138AA,
-    0xE38DEE4D,
-    0xB0FB0E4E
-};
-
-inline uint32_t P0(uint32_t x) {
-    return x ^ (x << 9) ^ (x << 17);
-}
-
-inline uint32_t P1(uint32_t x) {
-    return x ^ (x << 15) ^ (x << 23);
-}
-
-inline uint32_t FF(uint32_t x, uint32_t y, uint32_t z) {
-    return (x & y) | (x & z) | (y & z);
-}
-
-inline uint32_t GG(uint32_t x, uint32_t y, uint32_t z) {
-    return (x & y) | ((~x) & z);
+void generate_random_message(uint8_t* message, size_t length) {
+    random_device rd;
+    mt19937 gen(rd());
+    uniform_int_distribution<> dis(0, 255);
+    for (size_t i = 0; i < length; ++i) {
+        message[i] = static_cast<uint8_t>(dis(gen));
+    }
 }
 
-inline uint32_t left_rotate(uint32_t value, int shift) {
-    return (value << shift) | (value >> (32 - shift));
+// ʮַΪֽ
+void hex_to_bytes(const char* hex, uint8_t* out, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = static_cast<uint8_t>(stoi(string(hex + 2 * i, 2), nullptr, 16));
+    }
 }
 
-uint64_t bswap64(uint64_t value) {
-    return ((value & 0x00000000000000FFULL) << 56) |
-        ((value & 0x000000000000FF00ULL) << 40) |
-        ((value & 0x0000000000FF0000ULL) << 24) |
-        ((value & 0x00000000FF000000ULL) << 8) |
-        ((value & 0x000000FF00000000ULL) >> 8) |
-        ((value & 0x0000FF0000000000ULL) >> 24) |
-        ((value & 0x00FF000000000000ULL) >> 40) |
-        ((value & 0xFF00000000000000ULL) >> 56);
+void print_bytes(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        cout << hex << uppercase << setw(2) << setfill('0') << static_cast<int>(data[i]);
+    }
+    cout << dec << setfill(' ');
 }
 
-void pad_message(const uint8_t* msg, size_t msg_len, vector<uint8_t>& padded, size_t& padded_len) {
-    size_t bit_length = msg_len * 8;
-    padded.reserve(msg_len + 64);
-    memcpy(padded.data(), msg, msg_len);
-    padded.push_back(0x80);
+//  GB/T 32918 ʾеԿ˶ Z_A ǩٲԿǩǩٶ
+void run_sm2_demo() {
+    const char* d_hex = "3945208F7B2144B13F36E38AC6D39F95889393692860B51A42FB81EF4DF7C5B8";
+    const char* k_hex = "59276E27D506861A16680F3AD9C02DCCEF3CC1FA3CDBE4CE6D54B80DEAC1BC21";
+    const char* r_hex = "F5A03B0648D2C4630EEAC513E1BB81A15944DA3827D5B74143AC7EACEEE720B3";
+    const char* s_hex = "B1B6AA29DF212FD8763182BC0D421CA1BB9038FD1F7F42D4840B69C485BBC1AA";
+    const string message = "message digest";
+    const uint8_t* msg = reinterpret_cast<const uint8_t*>(message.data());
+
+    uint8_t d[SM2_BYTES], k_bytes[SM2_BYTES], expected[2 * SM2_BYTES];
+    hex_to_bytes(d_hex, d, SM2_BYTES);
+    hex_to_bytes(k_hex, k_bytes, SM2_BYTES);
+    hex_to_bytes(r_hex, expected, SM2_BYTES);
+    hex_to_bytes(s_hex, expected + SM2_BYTES, SM2_BYTES);
+
+    sm2_private_key priv;
+    sm2_public_key pub;
+    sm2_set_private_key(priv, d);
+    sm2_derive_public_key(priv, pub);
+    uint8_t e[SM3_DIGEST_BYTES];
+    sm2_message_digest(pub, msg, message.size(), e);
+    sm2_bn k;
+    sm2_bn_from_bytes(k, k_bytes);
+    sm2_nonce nonce;
+    sm2_nonce_from_scalar(nonce, k);
+    sm2_signature sig;
+    sm2_sign_digest_with_nonce(priv, e, nonce, sig);
 
-    size_t total_bits = (msg_len + 1) * 8;
-    size_t needed_bits = (448 - (total_bits % 512)) % 512;
-    size_t needed_bytes = (needed_bits + 7) / 8;
+    cout << "==============================================================" << endl;
+    cout << "SM2 ׼ʾ Z_A: ";
+    print_bytes(pub.za, SM3_DIGEST_BYTES);
+    cout << endl << "ǩ r: ";
+    print_bytes(sig.r, SM2_BYTES);
+    cout << endl << "ǩ s: ";
+    print_bytes(sig.s, SM2_BYTES);
+    bool matches = memcmp(sig.r, expected, SM2_BYTES) == 0 && memcmp(sig.s, expected + SM2_BYTES, SM2_BYTES) == 0;
+    cout << endl << "׼" << (matches ? "һ" : "һ") << "ǩ" << (sm2_verify(pub, msg, message.size(), sig) ? "ͨ" : "ʧ") << endl;
+
+    constexpr int SIGN_ITERATIONS = 200;
+    sm2_generate_keypair(priv, pub);
+    vector<uint8_t> random_message(1024);
+    generate_random_message(random_message.data(), random_message.size());
+    vector<sm2_signature> signatures(SIGN_ITERATIONS);
+
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < SIGN_ITERATIONS; ++i) {
+        sm2_sign(priv, pub, random_message.data(), random_message.size(), signatures[i]);
+    }
+    auto middle = chrono::high_resolution_clock::now();
+    int valid = 0;
+    for (int i = 0; i < SIGN_ITERATIONS; ++i) {
+        valid += sm2_verify(pub, random_message.data(), random_message.size(), signatures[i]);
+    }
+    auto end = chrono::high_resolution_clock::now();
+
+    // ԤȺǩֻ߲ʣģ n 
+    sm2_nonce_pool pool(SIGN_ITERATIONS);
+    pool.wait_until_full();
+    auto pool_start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < SIGN_ITERATIONS; ++i) {
+        sm2_sign(priv, pub, random_message.data(), random_message.size(), signatures[i], &pool);
+    }
+    auto pool_end = chrono::high_resolution_clock::now();
+    for (int i = 0; i < SIGN_ITERATIONS; ++i) {
+        valid += sm2_verify(pub, random_message.data(), random_message.size(), signatures[i]);
+    }
 
-    padded.insert(padded.end(), needed_bytes, 0x00);
-    msg_len += needed_bytes;
+    random_message[0] ^= 1;
+    bool tampered = sm2_verify(pub, random_message.data(), random_message.size(), signatures[0]);
 
-    uint64_t bit_length_be = bswap64(static_cast<uint64_t>(bit_length));
-    padded.resize(msg_len + sizeof(uint64_t));
-    memcpy(padded.data() + msg_len, &bit_length_be, sizeof(uint64_t));
-    padded_len = padded.size();
+    chrono::duration<double, milli> sign_time = middle - start;
+    chrono::duration<double, milli> verify_time = end - middle;
+    chrono::duration<double, milli> pool_time = pool_end - pool_start;
+    cout << "Կǩ " << SIGN_ITERATIONS << " Σƽ " << sign_time.count() / SIGN_ITERATIONS << " msʹƽ "
+        << pool_time.count() / SIGN_ITERATIONS << " msǩƽ " << verify_time.count() / SIGN_ITERATIONS << " msͨ "
+        << valid << "/" << 2 * SIGN_ITERATIONS << " " << endl;
+    cout << "۸ĺϢ֤: " << (tampered ? "ͨ" : "ȷܾ") << endl;
 }
 
-void generate_random_message(uint8_t* message, size_t length) {
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> dis(0, 255);
-    for (size_t i = 0; i < length; ++i) {
-        message[i] = static_cast<uint8_t>(dis(gen));
+// Կǩֱǩǩ۸мܷλ
+void run_sm2_batch_demo() {
+    constexpr int KEY_COUNT = 16;
+    constexpr int BATCH_SIZE = 1000;
+    vector<sm2_private_key> privs(KEY_COUNT);
+    vector<sm2_public_key> pubs(KEY_COUNT);
+    for (int i = 0; i < KEY_COUNT; ++i) {
+        sm2_generate_keypair(privs[i], pubs[i]);
     }
-}
-
-void sm3_hash(const uint8_t* msg, size_t msg_len, vector<uint8_t>& hash_output) {
-    vector<uint8_t> padded;
-    size_t padded_len = 0;
-    pad_message(msg, msg_len, padded, padded_len);
-
-    uint32_t state[8];
-    memcpy(state, IV, sizeof(IV));
 
-    for (size_t i = 0; i <= padded_len - SM3_BLOCK_SIZE; i += SM3_BLOCK_SIZE) {
-        if (i + SM3_BLOCK_SIZE > padded_len) {
-            break;
-        }
+    vector<sm2_batch_item> items(BATCH_SIZE);
+    vector<uint8_t> message(256);
+    for (int i = 0; i < BATCH_SIZE; ++i) {
+        sm2_batch_item& item = items[i];
+        generate_random_message(message.data(), message.size());
+        item.pub = &pubs[i % KEY_COUNT];
+        sm2_message_digest(*item.pub, message.data(), message.size(), item.e);
+        uint8_t recovery_id;
+        sm2_sign_digest(privs[i % KEY_COUNT], item.e, item.sig, nullptr, &recovery_id);
+        item.recovery_id = recovery_id;
+    }
 
-        uint32_t W[68];
-        for (int j = 0; j < 16; ++j) {
-            W[j] = (padded[i + 4 * j] << 24) |
-                (padded[i + 4 * j + 1] << 16) |
-                (padded[i + 4 * j + 2] << 8) |
-                (padded[i + 4 * j + 3]);
-        }
-        for (int j = 16; j < 68; ++j) {
-            W[j] = P1(W[j - 16] ^ W[j - 9] ^ P0(W[j - 15] ^ W[j - 1])) ^ P0(W[j - 14] ^ W[j - 2]);
+    auto start = chrono::high_resolution_clock::now();
+    int single_valid = 0;
+    for (const sm2_batch_item& item : items) {
+        single_valid += sm2_verify_digest(*item.pub, item.e, item.sig);
+    }
+    auto middle = chrono::high_resolution_clock::now();
+    vector<uint8_t> valid;
+    size_t batch_valid = sm2_batch_verify(items, valid);
+    auto end = chrono::high_resolution_clock::now();
+
+    // ۸ 3 ǩ 1 ȱٻָʶ2 ָʶ3ǩЧӦͨ
+    const int tampered[] = { 17, 400, 901 };
+    for (int index : tampered) {
+        items[index].sig.s[SM2_BYTES - 1] ^= 1;
+    }
+    items[650].recovery_id = -1;
+    items[651].recovery_id ^= 1;
+    items[652].recovery_id ^= 2;
+    auto bad_start = chrono::high_resolution_clock::now();
+    size_t bad_valid = sm2_batch_verify(items, valid);
+    auto bad_end = chrono::high_resolution_clock::now();
+
+    chrono::duration<double, milli> single_time = middle - start;
+    chrono::duration<double, milli> batch_time = end - middle;
+    chrono::duration<double, milli> bad_time = bad_end - bad_start;
+    cout << "==============================================================" << endl;
+    cout << KEY_COUNT << " Կ " << BATCH_SIZE << " ǩǩƽ " << single_time.count() / BATCH_SIZE
+        << " msͨ " << single_valid << " ǩƽ " << batch_time.count() / BATCH_SIZE << " msͨ "
+        << batch_valid << " " << endl;
+    cout << "۸ 3 ǩʱ " << bad_time.count() << " msͨ " << bad_valid << " λЧǩ:";
+    for (size_t i = 0; i < valid.size(); ++i) {
+        if (!valid[i]) {
+            cout << " " << i;
         }
+    }
+    cout << endl;
+}
 
-        uint32_t A = state[0];
-        uint32_t B = state[1];
-        uint32_t C = state[2];
-        uint32_t D = state[3];
-        uint32_t E = state[4];
-        uint32_t F = state[5];
-        uint32_t G = state[6];
-        uint32_t H = state[7];
-
-        for (int j = 0; j < SM3_ROUNDS; ++j) {
-            uint32_t SS1 = left_rotate((left_rotate(A, 12) + E + F), 7);
-            uint32_t SS2 = SS1 ^ left_rotate(A, 12);
-            uint32_t TT1 = FF(A, B, C) + SS2 + GG(D, E, F) + W[j];
-            uint32_t TT2 = GG(E, F, G) + SS1 + FF(D, E, F) + W[j + 4];
-            D = C;
-            C = left_rotate(B, 9);
-            B = A;
-            A = TT1;
-            H = G;
-            G = F;
-            F = E;
-            E = P0(TT2);
-        }
+// һζϢ˶Խܽٲݵʽӽٶ
+void run_sm2_encrypt_demo() {
+    sm2_private_key priv;
+    sm2_public_key pub;
+    sm2_generate_keypair(priv, pub);
 
-        state[0] ^= A;
-        state[1] ^= B;
-        state[2] ^= C;
-        state[3] ^= D;
-        state[4] ^= E;
-        state[5] ^= F;
-        state[6] ^= G;
-        state[7] ^= H;
+    const string message = "encryption standard";
+    vector<uint8_t> cipher, plain;
+    sm2_encrypt(pub, reinterpret_cast<const uint8_t*>(message.data()), message.size(), cipher);
+    bool ok = sm2_decrypt(priv, cipher.data(), cipher.size(), plain) && string(plain.begin(), plain.end()) == message;
+    cout << "==============================================================" << endl;
+    cout << "SM2  \"" << message << "\" õ C1 || C3 || C2: ";
+    print_bytes(cipher.data(), cipher.size());
+    cout << endl << "ܽ" << (ok ? "һ" : "һ");
+    cipher.back() ^= 1;
+    cout << "۸ C2 " << (sm2_decrypt(priv, cipher.data(), cipher.size(), plain) ? "ͨ" : "ȷܾ") << endl;
+
+    // ÿֻ 1MBC2 ԭظģC3 ڽʱõ
+    constexpr size_t PAYLOAD_SIZE = 64 << 20;
+    constexpr size_t CHUNK_SIZE = 1 << 20;
+    vector<uint8_t> payload(PAYLOAD_SIZE);
+    generate_random_message(payload.data(), CHUNK_SIZE);
+    for (size_t pos = CHUNK_SIZE; pos < PAYLOAD_SIZE; pos += CHUNK_SIZE) {
+        memcpy(payload.data() + pos, payload.data(), CHUNK_SIZE);
     }
-
-    hash_output.resize(SM3_DIGEST_SIZE / 8);
-    for (int i = 0; i < 8; ++i) {
-        hash_output[i * 4] = (state[i] >> 24) & 0xFF;
-        hash_output[i * 4 + 1] = (state[i] >> 16) & 0xFF;
-        hash_output[i * 4 + 2] = (state[i] >> 8) & 0xFF;
-        hash_output[i * 4 + 3] = state[i] & 0xFF;
+    vector<uint8_t> original = payload;
+    uint8_t c1[SM2_C1_SIZE], c3[SM3_DIGEST_BYTES];
+    sm2_cipher_context ctx;
+
+    auto start = chrono::high_resolution_clock::now();
+    sm2_encrypt_init(ctx, pub, PAYLOAD_SIZE, c1);
+    for (size_t pos = 0; pos < PAYLOAD_SIZE; pos += CHUNK_SIZE) {
+        sm2_encrypt_update(ctx, payload.data() + pos, CHUNK_SIZE, payload.data() + pos);
     }
+    sm2_encrypt_final(ctx, c3);
+    auto middle = chrono::high_resolution_clock::now();
+    sm2_decrypt_init(ctx, priv, c1, PAYLOAD_SIZE);
+    for (size_t pos = 0; pos < PAYLOAD_SIZE; pos += CHUNK_SIZE) {
+        sm2_decrypt_update(ctx, payload.data() + pos, CHUNK_SIZE, payload.data() + pos);
+    }
+    bool stream_ok = sm2_decrypt_final(ctx, c3) && payload == original;
+    auto end = chrono::high_resolution_clock::now();
+
+    chrono::duration<double, milli> encrypt_time = middle - start;
+    chrono::duration<double, milli> decrypt_time = end - middle;
+    double megabytes = PAYLOAD_SIZE / (1024.0 * 1024.0);
+    cout << "ʽ " << megabytes << " MB ʱ " << encrypt_time.count() << " ms" << megabytes * 1000.0 / encrypt_time.count()
+        << " MB/sܺʱ " << decrypt_time.count() << " msܽ" << (stream_ok ? "һ" : "һ") << endl;
 }
 
 int main() {
@@ -197,5 +270,9 @@ int main() {
     cout << "==============================================================" << endl;
     cout << "ִ " << ITERATIONS << " SM3ϣʱΪ: " << total_time << " msƽʱΪ: " << average_time << " ms" << endl;
 
+    run_sm2_demo();
+    run_sm2_batch_demo();
+    run_sm2_encrypt_demo();
+
     return 0;
 }
\ No newline at end of file